@@ -0,0 +1,235 @@
+// Synthetic Rotate program generator for the benchmark suite
+// usage: gen SIZE [SEED] > out.vr    SIZE takes a k, m or g suffix
+//
+// NOTE(5717): output only depends on SIZE and SEED. Every unit sticks to
+// what the parser accepts today: imports, hex/binary constants, structs,
+// enums, functions with params, nested if/else, while and for-in blocks,
+// long expressions, calls, member assignment, string/char literals and
+// nested comments, and it type checks: every name used is declared. Keep it
+// in sync when the grammar grows.
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define internal static
+
+typedef uint64_t u64;
+typedef uint32_t u32;
+
+typedef struct
+{
+    FILE *out;
+    u64 state;   // splitmix64
+    u64 written; // bytes so far
+    u32 unit;    // names are made unique with the unit number
+} Gen;
+
+internal u64
+gen_next(Gen *g)
+{
+    u64 z = (g->state += 0x9E3779B97F4A7C15ull);
+    z     = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z     = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// uniform in [0, n)
+internal u32
+gen_below(Gen *g, u32 n)
+{
+    return (u32)(gen_next(g) % n);
+}
+
+__attribute__((format(printf, 2, 3))) internal void
+emit(Gen *g, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    const int n = vfprintf(g->out, fmt, args);
+    va_end(args);
+    if (n > 0) g->written += (u64)n;
+}
+
+internal void
+indent(Gen *g, u32 depth)
+{
+    for (u32 i = 0; i < depth; i++) emit(g, "    ");
+}
+
+internal const char *const binary_ops[] = {"+", "-", "*", "/", "%", "==", "!=", "<", ">", "<=", ">="};
+internal const char *const logic_ops[]  = {"and", "or"};
+
+internal void
+gen_operand(Gen *g, u32 params)
+{
+    switch (gen_below(g, 8))
+    {
+        case 0: emit(g, "%u", gen_below(g, 100000)); break;
+        case 1: emit(g, "0x%X", gen_below(g, 0xFFFFFF)); break;
+        case 2: emit(g, "0b%u%u%u%u1", gen_below(g, 2), gen_below(g, 2), gen_below(g, 2), gen_below(g, 2)); break;
+        case 3: emit(g, "%u.%u", gen_below(g, 1000), gen_below(g, 1000)); break;
+        case 4: emit(g, "(p%u - %u)", gen_below(g, params), gen_below(g, 50)); break;
+        case 5: emit(g, "k%u", g->unit); break;
+        default: emit(g, "p%u", gen_below(g, params)); break;
+    }
+}
+
+// a chain of `terms` operands joined by arithmetic operators
+internal void
+gen_expression(Gen *g, u32 params, u32 terms)
+{
+    for (u32 i = 0; i < terms; i++)
+    {
+        if (i) emit(g, " %s ", binary_ops[gen_below(g, 5)]);
+        gen_operand(g, params);
+    }
+}
+
+internal void
+gen_condition(Gen *g, u32 params)
+{
+    const u32 parts = 1 + gen_below(g, 3);
+    for (u32 i = 0; i < parts; i++)
+    {
+        if (i) emit(g, " %s ", logic_ops[gen_below(g, 2)]);
+        // NOTE(5717): a condition may not open with `(`, only negations are grouped
+        const int negate = gen_below(g, 4) == 0;
+        emit(g, "%sp%u %s ", negate ? "!(" : "", gen_below(g, params), binary_ops[5 + gen_below(g, 6)]);
+        gen_operand(g, params);
+        if (negate) emit(g, ")");
+    }
+}
+
+internal void gen_block(Gen *g, u32 params, u32 depth);
+
+internal void
+gen_statement(Gen *g, u32 params, u32 depth)
+{
+    indent(g, depth);
+    const u32 kind = depth < 4 ? gen_below(g, 10) : gen_below(g, 5);
+    switch (kind)
+    {
+        case 0:
+            emit(g, "v%u := ", gen_below(g, 1000));
+            gen_expression(g, params, 2 + gen_below(g, 24));
+            emit(g, "\n");
+            break;
+        case 1: emit(g, "s%u := \"unit %u says \\\"hi\\\"\\n\"\n", gen_below(g, 1000), g->unit); break;
+        case 2: emit(g, "c%u := '%c'\n", gen_below(g, 1000), 'a' + gen_below(g, 26)); break;
+        case 3:
+            emit(g, "io.print_i(f%u(pt%u", g->unit, g->unit);
+            for (u32 i = 0; i < params; i++)
+            {
+                emit(g, ", ");
+                gen_operand(g, params);
+            }
+            emit(g, "))\n");
+            break;
+        case 4:
+            emit(g, "pt%u.x = ", g->unit);
+            gen_expression(g, params, 1 + gen_below(g, 4));
+            emit(g, "\n");
+            break;
+        case 5:
+        case 6:
+            emit(g, "if ");
+            gen_condition(g, params);
+            gen_block(g, params, depth);
+            if (gen_below(g, 2))
+            {
+                emit(g, " else");
+                gen_block(g, params, depth);
+            }
+            emit(g, "\n");
+            break;
+        case 7:
+            emit(g, "while (");
+            gen_condition(g, params);
+            emit(g, ")");
+            gen_block(g, params, depth);
+            emit(g, "\n");
+            break;
+        case 8:
+            emit(g, "for i%u in 0..%u", depth, 1 + gen_below(g, 64));
+            gen_block(g, params, depth);
+            emit(g, "\n");
+            break;
+        default:
+            emit(g, "/* note %u /* nested %u */ */\n", g->unit, depth);
+            break;
+    }
+}
+
+internal void
+gen_block(Gen *g, u32 params, u32 depth)
+{
+    emit(g, " {\n");
+    const u32 count = 1 + gen_below(g, 5);
+    for (u32 i = 0; i < count; i++) gen_statement(g, params, depth + 1);
+    indent(g, depth);
+    emit(g, "}");
+}
+
+internal void
+gen_unit(Gen *g)
+{
+    const u32 u = g->unit;
+    emit(g, "// unit %u\n", u);
+    if (gen_below(g, 4) == 0) emit(g, "m%u :: import \"lib/m%u\"\n", u, u);
+    emit(g, "k%u :: 0x%X\n", u, gen_below(g, 0xFFFF));
+    emit(g, "mask%u :: 0b%u%u%u1\n", u, gen_below(g, 2), gen_below(g, 2), gen_below(g, 2));
+
+    emit(g, "struct Point%u {\n    x: int\n    y: float\n    tags: [%u]char\n}\n", u, 1 + gen_below(g, 16));
+    emit(g, "enum Color%u {\n", u);
+    const u32 members = 2 + gen_below(g, 6);
+    for (u32 i = 0; i < members; i++) emit(g, "    C%u_%u,\n", u, i);
+    emit(g, "}\n");
+
+    const u32 params = 1 + gen_below(g, 6);
+    emit(g, "f%u :: fn(pt%u: Point%u", u, u, u);
+    for (u32 i = 0; i < params; i++) emit(g, ", p%u: %s", i, i % 3 == 2 ? "float" : "int");
+    emit(g, ") int");
+    gen_block(g, params, 0);
+    emit(g, "\n\n");
+}
+
+internal u64
+parse_size(const char *str)
+{
+    char *end     = NULL;
+    const u64 num = strtoull(str, &end, 10);
+    switch (*end)
+    {
+        case 'k': case 'K': return num << 10;
+        case 'm': case 'M': return num << 20;
+        case 'g': case 'G': return num << 30;
+        case '\0': return num;
+        default: return 0;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc < 2 || parse_size(argv[1]) == 0)
+    {
+        fprintf(stderr, "usage: %s SIZE[k|m|g] [SEED] > out.vr\n", argv[0]);
+        return 1;
+    }
+
+    const u64 size = parse_size(argv[1]);
+    Gen g          = {stdout, argc > 2 ? strtoull(argv[2], NULL, 10) : 5717, 0, 0};
+
+    static char buffer[1 << 16];
+    setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+
+    emit(&g, "io :: import \"std/io\"\n\n");
+    while (g.written < size)
+    {
+        gen_unit(&g);
+        g.unit++;
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#!/bin/sh
+# Benchmark suite: generates synthetic programs and records stage throughput
+# usage: bench/run.sh [SIZE...]     (default: 10k 100k 1m 10m 100m)
+#
+# env: ROTATE  compiler binary     (build/rotate)
+#      GEN     generator binary    (build/gen, built from bench/gen.c)
+#      RUNS    timed runs per size (5)
+#      WARMUP  warmup runs         (1)
+#      SEED    generator seed      (5717)
+#      CORPUS  where programs go   (build/bench)
+#      OUT     csv file            (build/bench/results.csv)
+#      ARGS    extra compiler args (e.g. '-j 1')
+set -eu
+
+ROTATE=${ROTATE:-build/rotate}
+GEN=${GEN:-build/gen}
+RUNS=${RUNS:-5}
+WARMUP=${WARMUP:-1}
+SEED=${SEED:-5717}
+CORPUS=${CORPUS:-build/bench}
+OUT=${OUT:-$CORPUS/results.csv}
+ARGS=${ARGS:-}
+CC=${CC:-cc}
+
+[ $# -gt 0 ] || set -- 10k 100k 1m 10m 100m
+
+if [ ! -x "$ROTATE" ]; then
+    echo "missing $ROTATE, run 'make release' first" >&2
+    exit 1
+fi
+
+mkdir -p "$CORPUS" "$(dirname "$GEN")"
+if [ ! -x "$GEN" ] || [ bench/gen.c -nt "$GEN" ]; then
+    $CC -std=gnu11 -O2 -o "$GEN" bench/gen.c
+fi
+
+echo "size,bytes,tokens,nodes,stage,min,median,p95,max,mb_per_s,tokens_per_s,allocations" > "$OUT"
+
+for size in "$@"; do
+    program="$CORPUS/gen_${size}_${SEED}.vr"
+    [ -f "$program" ] || "$GEN" "$size" "$SEED" > "$program"
+
+    # the --json report is the last five lines, the header line holds the
+    # totals and each stage line its min/median/p95/max in seconds
+    # shellcheck disable=SC2086
+    "$ROTATE" "$program" $ARGS --bench "$RUNS" --warmup "$WARMUP" --json 2>/dev/null |
+        awk -v size="$size" '
+            function field(line, key,    rest) {
+                rest = substr(line, index(line, "\"" key "\":") + length(key) + 3)
+                sub(/[,}].*/, "", rest)
+                return rest + 0
+            }
+            /^\{"runs"/ {
+                bytes = field($0, "bytes"); tokens = field($0, "tokens")
+                nodes = field($0, "nodes"); allocs = field($0, "allocations")
+            }
+            /"min":/ {
+                stage = $0; sub(/^ *"/, "", stage); sub(/".*/, "", stage)
+                median = field($0, "median")
+                mbs = 0; tps = 0
+                if (median > 0) { mbs = bytes / median / 1e6; tps = tokens / median }
+                printf "%s,%d,%d,%d,%s,%.9f,%.9f,%.9f,%.9f,%.2f,%.0f,%d\n",
+                    size, bytes, tokens, nodes, stage,
+                    field($0, "min"), median, field($0, "p95"), field($0, "max"), mbs, tps, allocs
+            }' >> "$OUT"
+
+    awk -F, -v size="$size" '$1 == size { printf "%-6s %-8s median %10.3f ms  %8.1f MB/s  %12.0f tokens/s\n", $1, $5, $7 * 1000, $10, $11 }' "$OUT"
+done
+
+echo "results written to $OUT"
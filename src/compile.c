@@ -2,30 +2,68 @@
 #include "include/common.h"
 #include "include/file.h"
 #include "include/log.h"
+#include "include/pool.h"
+#include "include/server.h"
 
+#include "fe/cache.h"
+#include "fe/checker.h"
+#include "fe/module.h"
 #include "fe/parser.h"
 
+#include <sys/stat.h>
+#if !OS_WIN
+#include <dirent.h>
+#include <glob.h>
+#endif
+
 #define MIN_TOKEN_COUNT 2u
 #define OUTPUT_LOG_FILE "output.org"
 
+cstr
+stage_to_string(Stage s)
+{
+    switch (s)
+    {
+        case ST_FILE: return "FILE READ";
+        case ST_LEXER: return "LEXER";
+        case ST_PARSER: return "PARSER";
+        case ST_MODULES: return "MODULES";
+        case ST_CACHE: return "CACHE";
+        case ST_TCHECKER: return "TYPE CHECKER";
+        case ST_LOGGER: return "LOGGER";
+        default: return "UNKNOWN";
+    }
+}
+
+// `copy` for contents kept across compilations, a mapping follows the file on disk
 internal u8
-compile_file_stage(compile_options *options, File *file)
+compile_file_stage(compile_options *options, File *file, bool copy)
 {
     options->st = ST_FILE;
-    File temp_file = file_read(options->filename);
+    File temp_file = copy ? file_read_copy(options->filename) : file_read(options->filename);
     ASSERT_RET_FAIL(temp_file.valid_code == success, "File read error: Unable to read the file or invalid format");
     memcpy(file, &temp_file, sizeof(File));
     return SUCCESS;
 }
 
 internal u8
-compile_lexer_stage(compile_options *options, File *file, Lexer *lexer, compile_info_stats *stats)
+compile_lexer_stage(compile_options *options, File *file, Lexer *lexer, const LexEdit *edit,
+                    TknEdit *changed, compile_info_stats *stats)
 {
     options->st = ST_LEXER;
-    *lexer = lexer_init(file);
-    u8 status = lexer_lex(lexer);
+    u8 status;
+    if (edit) {
+        // warm files only relex around what changed since their last compilation
+        status = lexer_relex(lexer, *edit, changed);
+    } else {
+        // bench reruns lex the same file again into the same buffers
+        if (lexer->file == file) lexer_reset(lexer);
+        else *lexer = lexer_init(file);
+        status = lexer_lex_parallel(lexer, options->jobs);
+    }
 
-    if (lexer_get_tokens(lexer)->count < MIN_TOKEN_COUNT) {
+    // a failed relex clears the tokens, the file is not empty for that
+    if ((!edit || status == SUCCESS) && tkn_count(lexer_get_tokens(lexer)) < MIN_TOKEN_COUNT) {
         log_error("file is empty");
     }
 
@@ -33,18 +71,22 @@ compile_lexer_stage(compile_options *options, File *file, Lexer *lexer, compile_
         return FAILURE;
     }
 
-    stats->token_count = array_length(lexer->tokens);
+    stats->token_count = tkn_count(&lexer->tokens);
     return SUCCESS;
 }
 
+// with `changed` the parser holds the tree of the tokens before it
 internal u8
-compile_parser_stage(compile_options *options, Lexer *lexer, Parser *parser)
+compile_parser_stage(compile_options *options, Lexer *lexer, Parser *parser, const TknEdit *changed, i64 shift,
+                     compile_info_stats *stats)
 {
     options->st = ST_PARSER;
-    *parser = parser_init(lexer);
+    if (parser->lexer != lexer) *parser = parser_init(lexer);
+    else if (!changed || options->lex_only) parser_reset(parser);
 
     if (!options->lex_only) {
-        u8 status = parser_parse(parser);
+        u8 status = changed ? parser_reparse(parser, *changed, shift) : parser_parse_parallel(parser, options->jobs);
+        stats->node_count = parser->node_count;
         if (status == FAILURE) {
             parser_report_error(parser);
             return FAILURE;
@@ -56,7 +98,19 @@ compile_parser_stage(compile_options *options, Lexer *lexer, Parser *parser)
 }
 
 internal u8
-compile_logger_stage(compile_options *options, File *file, Lexer *lexer, Parser *parser)
+compile_checker_stage(compile_options *options, Parser *parser, Checker *checker)
+{
+    if (options->lex_only) {
+        return SUCCESS;
+    }
+
+    options->st = ST_TCHECKER;
+    if (checker->parser != parser) *checker = checker_init(parser);
+    return checker_check(checker, options->jobs);
+}
+
+internal u8
+compile_logger_stage(compile_options *options, File *file, Lexer *lexer, Parser *parser, Checker *checker)
 {
     if (!options->debug_info) {
         return SUCCESS;
@@ -69,55 +123,573 @@ compile_logger_stage(compile_options *options, File *file, Lexer *lexer, Parser
         return FAILURE;
     }
 
-    log_compilation(output, file, lexer, parser);
+    log_compilation(output, file, lexer, parser, checker);
     fclose(output);
     return SUCCESS;
 }
 
-compile_info_stats
-compile(compile_options *options)
+// the log needs the pointer tree and --lex stops before there is one
+internal bool
+compile_uses_cache(const compile_options *options)
+{
+    return options->cache_dir && !options->lex_only && !options->debug_info;
+}
+
+// stages after reading the file, timings go to `stats`, with `edit` the lexer
+// holds the tokens of the text before it and the parser their tree
+internal u8
+compile_source(compile_options *options, File *file, Lexer *lexer, Parser *parser, Checker *checker,
+               const LexEdit *edit, compile_info_stats *stats)
+{
+    // Stage 2: Lexical Analysis
+    TimeStamp start = time_now();
+    TknEdit changed = {0};
+    u8 status = compile_lexer_stage(options, file, lexer, edit, &changed, stats);
+    stats->stages[ST_LEXER] = time_since(start);
+    if (status == FAILURE) return FAILURE;
+
+    // Stage 3: Parsing
+    start = time_now();
+    const i64 shift = edit ? (i64)edit->inserted - (i64)edit->removed : 0;
+    status = compile_parser_stage(options, lexer, parser, edit ? &changed : nullptr, shift, stats);
+    stats->stages[ST_PARSER] = time_since(start);
+    if (status == FAILURE) return FAILURE;
+
+    // Stage 4: Type checking
+    start = time_now();
+    status = compile_checker_stage(options, parser, checker);
+    stats->stages[ST_TCHECKER] = time_since(start);
+    if (status == FAILURE) return FAILURE;
+
+    // Stage 5: Logging (if requested)
+    start = time_now();
+    status = compile_logger_stage(options, file, lexer, parser, checker);
+    if (options->debug_info) stats->stages[ST_LOGGER] = time_since(start);
+    return status == FAILURE ? FAILURE : SUCCESS;
+}
+
+/*
+ *
+ * Module mode
+ * NOTE(5717): with search roots the input is the entry module, everything it
+ * imports is loaded with it (see module.h), stage times are summed over the
+ * modules and the log is written for the entry module
+ *
+ */
+internal compile_info_stats
+compile_modules(compile_options *options)
+{
+    compile_info_stats stats = {0};
+    stats.file_count         = 1;
+
+    ModuleGraph graph = module_graph_make(options->include_dirs, options->include_count);
+    graph.cache_dir   = compile_uses_cache(options) ? options->cache_dir : nullptr;
+    stats.status      = module_graph_load(&graph, options->filename, options->jobs);
+    options->st       = graph.st;
+
+    stats.module_count        = (uint)module_count(&graph);
+    stats.stages[ST_MODULES]  = graph.resolve;
+    for (usize i = 0; i < module_count(&graph); i++)
+    {
+        const Module *m = module_at(&graph, i);
+        stats.file_size += m->file.length;
+        if (m->cache.base) {
+            stats.token_count += (uint)tkn_count(&m->cache.tokens);
+            stats.node_count += m->cache.node_count;
+            stats.cache_hits++;
+        } else {
+            if (m->lexer.file) stats.token_count += (uint)tkn_count(&m->lexer.tokens);
+            stats.node_count += m->parser.node_count;
+        }
+        for (Stage s = ST_FILE; s < ST_COUNT; s++) {
+            stats.stages[s].wall += m->stages[s].wall;
+            stats.stages[s].cpu += m->stages[s].cpu;
+        }
+    }
+
+    if (stats.status == SUCCESS && options->debug_info) {
+        Module *entry    = module_at(&graph, 0);
+        TimeStamp start  = time_now();
+        stats.status     = compile_logger_stage(options, &entry->file, &entry->lexer, &entry->parser,
+                                                  &entry->checker);
+        stats.stages[ST_LOGGER] = time_since(start);
+    }
+    if (stats.status == FAILURE) stats.failed_count = 1;
+
+    module_graph_free(&graph);
+    return stats;
+}
+
+internal compile_info_stats
+compile_file(compile_options *options)
 {
+    if (options->include_count && !options->lex_only) return compile_modules(options);
+
     compile_info_stats exit_stats = {0};
+    exit_stats.file_count = 1;
     File file = {0};
     Lexer lexer = {0};
     Parser parser = {0};
+    Checker checker = {0};
 
     // Stage 1: File Reading
-    if (compile_file_stage(options, &file) == FAILURE) {
-        exit_stats.status = FAILURE;
+    TimeStamp start = time_now();
+    u8 status = compile_file_stage(options, &file, false);
+    exit_stats.stages[ST_FILE] = time_since(start);
+    if (status == FAILURE) {
+        exit_stats.status       = FAILURE;
+        exit_stats.failed_count = 1;
         return exit_stats;
     }
     exit_stats.file_size = file.length;
 
-    // Stage 2: Lexical Analysis
-    if (compile_lexer_stage(options, &file, &lexer, &exit_stats) == FAILURE) {
-        exit_stats.status = FAILURE;
-        goto cleanup;
+    // Stages 2 to 4 come from the cache when the contents were seen before
+    if (compile_uses_cache(options)) {
+        CacheEntry entry;
+        start = time_now();
+        const bool hit = cache_load(options->cache_dir, &file, &entry);
+        exit_stats.stages[ST_CACHE] = time_since(start);
+        if (hit) {
+            exit_stats.token_count = (uint)tkn_count(&entry.tokens);
+            exit_stats.node_count  = entry.node_count;
+            exit_stats.cache_hits  = 1;
+            exit_stats.status      = SUCCESS;
+            cache_entry_free(&entry);
+            file_free(&file);
+            return exit_stats;
+        }
     }
 
-    // Stage 3: Parsing
-    if (compile_parser_stage(options, &lexer, &parser) == FAILURE) {
-        exit_stats.status = FAILURE;
-        goto cleanup;
-    }
+    exit_stats.status = compile_source(options, &file, &lexer, &parser, &checker, nullptr, &exit_stats);
+    if (exit_stats.status == FAILURE) exit_stats.failed_count = 1;
 
-    // Stage 4: Logging (if requested)
-    if (compile_logger_stage(options, &file, &lexer, &parser) == FAILURE) {
-        exit_stats.status = FAILURE;
-        goto cleanup;
+    // a failed store only costs the next run its hit
+    if (exit_stats.status == SUCCESS && compile_uses_cache(options)) {
+        start = time_now();
+        cache_store(options->cache_dir, &file, &lexer, &parser);
+        const TimeSpan spent = time_since(start);
+        exit_stats.stages[ST_CACHE].wall += spent.wall;
+        exit_stats.stages[ST_CACHE].cpu += spent.cpu;
     }
 
-    exit_stats.status = SUCCESS;
-
-cleanup:
     // Free resources
     file_free(&file);
     lexer_deinit(&lexer);
     parser_deinit(&parser);
+    checker_deinit(&checker);
 
     return exit_stats;
 }
 
+void
+compile_stats_add(compile_info_stats *total, const compile_info_stats *stats)
+{
+    total->file_size += stats->file_size;
+    total->token_count += stats->token_count;
+    total->node_count += stats->node_count;
+    total->module_count += stats->module_count;
+    total->cache_hits += stats->cache_hits;
+    for (Stage s = ST_FILE; s < ST_COUNT; s++) {
+        total->stages[s].wall += stats->stages[s].wall;
+        total->stages[s].cpu += stats->stages[s].cpu;
+    }
+    if (stats->status == FAILURE) {
+        total->failed_count++;
+        total->status = FAILURE;
+    }
+}
+
+/*
+ *
+ * Warm mode
+ * NOTE(5717): the caller keeps File/Lexer/Parser of one file across
+ * compilations (the server keeps one set per file), the file is read again
+ * and the tokens of the previous text are relexed around the one edit
+ * between both texts (lexer_relex), then only the declarations on the
+ * changed tokens are parsed again (parser_reparse)
+ *
+ */
+compile_info_stats
+compile_warm(compile_options *options, File *file, Lexer *lexer, Parser *parser, Checker *checker)
+{
+    compile_info_stats stats = {0};
+    stats.file_count         = 1;
+
+    File before;
+    memcpy(&before, file, sizeof(File));
+    TimeStamp start       = time_now();
+    u8 status             = compile_file_stage(options, file, true);
+    stats.stages[ST_FILE] = time_since(start);
+    if (status == FAILURE) {
+        file_free(file); // still the previous text
+        stats.status       = FAILURE;
+        stats.failed_count = 1;
+        return stats;
+    }
+
+    // tokens of a lex that ran to the end are the tokens of `before`, once the
+    // literals of replaced tokens outnumber the live ones a full lex reclaims them
+    const TokenStream *tokens = &lexer->tokens;
+    const bool relex = before.contents && lexer->file == file && tkn_count(tokens) > 0 &&
+                       tkn_kind(tokens, tkn_count(tokens) - 1) == Tkn_EOT &&
+                       lexer->dead_literals * 2 <= array_count(lexer->literals.values);
+    LexEdit edit = {0};
+    if (relex) edit = lexer_edit_between(before.contents, before.length, file->contents, file->length);
+    file_free(&before);
+
+    stats.file_size = file->length;
+    stats.status    = compile_source(options, file, lexer, parser, checker, relex ? &edit : nullptr, &stats);
+    if (stats.status == FAILURE) stats.failed_count = 1;
+    return stats;
+}
+
+/*
+ *
+ * Batch mode
+ * NOTE(5717): files are the unit of parallelism, each worker compiles whole
+ * files with its own Lexer/Parser and lexes them on its own thread. The
+ * diagnostics of a file are buffered and printed in input order after every
+ * file is done, so the output does not depend on the scheduling. Stage times
+ * are summed over the files and timed with the cpu clock of the worker
+ *
+ */
+typedef struct
+{
+    compile_info_stats stats;
+    Stage st; // stage the file stopped at
+    LogCapture diag;
+} BatchFile;
+
+typedef struct
+{
+    const compile_options *options;
+    BatchFile *files;
+} Batch;
+
+internal void
+compile_batch_task(void *ctx, uint index)
+{
+    Batch *batch  = ctx;
+    BatchFile *bf = &batch->files[index];
+
+    compile_options options = *batch->options;
+    options.filename        = options.files[index];
+    options.files           = &options.files[index];
+    options.file_count      = 1;
+    options.jobs            = 1;
+    options.debug_info      = false; // every file would write the same log
+
+    log_capture_begin(&bf->diag);
+    time_thread_cpu(true);
+
+    bf->stats = compile_file(&options);
+    bf->st    = options.st;
+    if (bf->stats.status == FAILURE) {
+        fprintf(log_output(), "%s: compilation failed at stage: %s\n", options.filename, stage_to_string(bf->st));
+    }
+
+    time_thread_cpu(false);
+    log_capture_end(&bf->diag);
+}
+
+internal compile_info_stats
+compile_batch(compile_options *options)
+{
+    const uint count = options->file_count;
+    BatchFile *files = mem_alloc(sizeof(BatchFile) * count);
+    memset(files, 0, sizeof(BatchFile) * count);
+
+    Batch batch = {options, files};
+    pool_run(options->jobs, count, compile_batch_task, &batch);
+
+    compile_info_stats total = {0};
+    total.file_count         = count;
+    total.status             = SUCCESS;
+    for (uint i = 0; i < count; i++)
+    {
+        BatchFile *bf = &files[i];
+        log_capture_flush(&bf->diag);
+
+        if (bf->stats.status == FAILURE && total.failed_count == 0) {
+            options->st = bf->st; // first failure in input order
+        }
+        compile_stats_add(&total, &bf->stats);
+    }
+
+    mem_free(files);
+    return total;
+}
+
+compile_info_stats
+compile(compile_options *options)
+{
+    if (options->file_count == 0) {
+        options->st = ST_FILE;
+        log_error("No input files");
+        return (compile_info_stats){.status = FAILURE};
+    }
+    return options->file_count > 1 ? compile_batch(options) : compile_file(options);
+}
+
+/*
+ *
+ * Report
+ *
+ */
+// per second rate of `count` over `seconds`, 0 for stages too quick to measure
+internal f64
+rate(f64 count, f64 seconds)
+{
+    return seconds > 0 ? count / seconds : 0;
+}
+
+#define MEGA (1024.0 * 1024.0)
+
+internal void
+print_compilation_stats(compile_info_stats stats, TimeSpan total)
+{
+    const f64 bytes  = stats.file_size;
+    const f64 tokens = stats.token_count;
+    const f64 nodes  = stats.node_count;
+
+    for (Stage s = ST_FILE; s < ST_COUNT; s++)
+    {
+        const TimeSpan t = stats.stages[s];
+        if (t.wall == 0 && t.cpu == 0) continue;
+
+        printf("[%sTIME%s] : %-12s %.5f sec wall, %.5f sec cpu", LMAGENTA BOLD, RESET, stage_to_string(s),
+               t.wall, t.cpu);
+        if (s == ST_FILE || s == ST_LEXER) printf(", %.3f mb/sec", rate(bytes / MEGA, t.wall));
+        if (s == ST_LEXER || s == ST_PARSER) printf(", %.3f M tokens/sec", rate(tokens / 1e6, t.wall));
+        if (s == ST_PARSER) printf(", %.3f M nodes/sec", rate(nodes / 1e6, t.wall));
+        printf("\n");
+    }
+    if (stats.file_count > 1) {
+        printf("[%sINFO%s] : %u Files, %u Failed (stage times summed over files)\n", LMAGENTA BOLD, RESET,
+               stats.file_count, stats.failed_count);
+    }
+    if (stats.module_count) printf("[%sINFO%s] : %u Modules\n", LMAGENTA BOLD, RESET, stats.module_count);
+    if (stats.cache_hits) printf("[%sINFO%s] : %u Cache hits\n", LMAGENTA BOLD, RESET, stats.cache_hits);
+    printf("[%sINFO%s] : %u Tokens, %u Nodes\n", LMAGENTA BOLD, RESET, stats.token_count, stats.node_count);
+    printf("[%sRATE%s] : %.3f mb/sec\n", LMAGENTA BOLD, RESET, rate(bytes / MEGA, total.wall));
+    printf("[%sMEM%s]  : %.3f mb peak rss\n", LMAGENTA BOLD, RESET, (f64)mem_peak_rss() / MEGA);
+    printf("[%sTIME%s] : %.5f sec wall, %.5f sec cpu\n", LMAGENTA BOLD, RESET, total.wall, total.cpu);
+}
+
+internal void
+print_json_string(cstr str)
+{
+    putchar('"');
+    for (; *str; str++)
+    {
+        if (*str == '"' || *str == '\\') printf("\\%c", *str);
+        else if ((u8)*str < 0x20) printf("\\u%04x", (u8)*str);
+        else putchar(*str);
+    }
+    putchar('"');
+}
+
+internal void
+print_compilation_stats_json(compile_info_stats stats, TimeSpan total, cstr filename)
+{
+    static cstr keys[ST_COUNT] = {
+        [ST_FILE] = "file", [ST_LEXER] = "lexer", [ST_PARSER] = "parser", [ST_MODULES] = "modules",
+        [ST_CACHE] = "cache",
+        [ST_TCHECKER] = "checker", [ST_LOGGER] = "logger",
+    };
+
+    if (stats.file_count > 1) {
+        printf("{\"files\": %u, \"failed\": %u", stats.file_count, stats.failed_count);
+    } else {
+        printf("{\"file\": ");
+        print_json_string(filename ? filename : "");
+    }
+    if (stats.module_count) printf(", \"modules\": %u", stats.module_count);
+    if (stats.cache_hits) printf(", \"cache_hits\": %u", stats.cache_hits);
+    printf(", \"bytes\": %u, \"tokens\": %u, \"nodes\": %u, \"peak_rss\": %llu,\n", stats.file_size,
+           stats.token_count, stats.node_count, mem_peak_rss());
+    printf(" \"stages\": {");
+    bool first = true;
+    for (Stage s = ST_FILE; s < ST_COUNT; s++)
+    {
+        const TimeSpan t = stats.stages[s];
+        if (!keys[s] || (t.wall == 0 && t.cpu == 0)) continue;
+        printf("%s\n  \"%s\": {\"wall\": %.9f, \"cpu\": %.9f, \"bytes_per_sec\": %.1f, "
+               "\"tokens_per_sec\": %.1f, \"nodes_per_sec\": %.1f}",
+               first ? "" : ",", keys[s], t.wall, t.cpu, rate(stats.file_size, t.wall),
+               rate(stats.token_count, t.wall), rate(stats.node_count, t.wall));
+        first = false;
+    }
+    printf("},\n \"total\": {\"wall\": %.9f, \"cpu\": %.9f, \"bytes_per_sec\": %.1f}}\n", total.wall,
+           total.cpu, rate(stats.file_size, total.wall));
+}
+
+int
+compile_report(compile_options *options, compile_info_stats stats, TimeSpan total)
+{
+    if (stats.status == FAILURE) {
+        log_stage(stage_to_string(options->st));
+        if (stats.file_count > 1) {
+            fprintf(stderr, "Compilation failed for %u of %u files\n", stats.failed_count, stats.file_count);
+        } else {
+            fprintf(stderr, "Compilation failed at stage: %s\n", stage_to_string(options->st));
+        }
+        return FAILURE;
+    }
+    log_info("Compilation succeeded.");
+
+    if (options->timer && !options->bench_runs) {
+        if (options->timer_json) print_compilation_stats_json(stats, total, options->filename);
+        else print_compilation_stats(stats, total);
+    }
+    return SUCCESS;
+}
+
+/*
+ *
+ * Benchmark mode
+ * NOTE(5717): the file is read once, every run lexes and parses it again
+ * into the buffers of the previous run, warmup runs are not recorded
+ *
+ */
+internal int
+compare_f64(const void *a, const void *b)
+{
+    const f64 x = *(const f64 *)a, y = *(const f64 *)b;
+    return (x > y) - (x < y);
+}
+
+// nearest rank percentile of sorted values
+internal f64
+percentile(const f64 *sorted, uint count, uint pct)
+{
+    uint rank = (count * pct + 99) / 100;
+    if (rank == 0) rank = 1;
+    return sorted[rank - 1];
+}
+
+typedef struct
+{
+    f64 min, median, p95, max;
+} BenchSummary;
+
+internal BenchSummary
+bench_summary(f64 *values, uint count)
+{
+    qsort(values, count, sizeof(f64), compare_f64);
+    return (BenchSummary){values[0], percentile(values, count, 50), percentile(values, count, 95),
+                          values[count - 1]};
+}
+
+internal void
+bench_report(compile_options *options, f64 *walls[ST_COUNT], f64 *allocs, const compile_info_stats *last)
+{
+    static cstr names[ST_COUNT] = {
+        [ST_FILE] = "file", [ST_LEXER] = "lexer", [ST_PARSER] = "parser", [ST_MODULES] = "modules",
+        [ST_CACHE] = "cache",
+        [ST_TCHECKER] = "checker", [ST_LOGGER] = "logger",
+    };
+    const uint runs        = options->bench_runs;
+    const BenchSummary mem = bench_summary(allocs, runs);
+    const f64 mb           = last->file_size / (1024.0 * 1024.0);
+
+    if (options->timer_json) {
+        printf("{\"runs\": %u, \"warmup\": %u, \"bytes\": %u, \"tokens\": %u, \"nodes\": %u, "
+               "\"allocations\": %.0f,\n \"stages\": {",
+               runs, options->bench_warmup, last->file_size, last->token_count, last->node_count, mem.median);
+    } else {
+        printf("[%sBENCH%s] : %u runs after %u warmup, %u bytes, %u tokens, %u nodes\n", LMAGENTA BOLD, RESET,
+               runs, options->bench_warmup, last->file_size, last->token_count, last->node_count);
+    }
+
+    bool first = true;
+    for (Stage s = ST_LEXER; s < ST_COUNT; s++)
+    {
+        if (!walls[s] || !names[s]) continue;
+        const BenchSummary t = bench_summary(walls[s], runs);
+        if (t.max == 0) continue;
+
+        if (options->timer_json) {
+            printf("%s\n  \"%s\": {\"min\": %.9f, \"median\": %.9f, \"p95\": %.9f, \"max\": %.9f}",
+                   first ? "" : ",", names[s], t.min, t.median, t.p95, t.max);
+        } else {
+            printf("[%sBENCH%s] : %-7s min %.4f, median %.4f, p95 %.4f, max %.4f ms (%.3f mb/sec median)\n",
+                   LMAGENTA BOLD, RESET, names[s], t.min * 1e3, t.median * 1e3, t.p95 * 1e3, t.max * 1e3,
+                   t.median > 0 ? mb / t.median : 0);
+        }
+        first = false;
+    }
+
+    if (options->timer_json) {
+        printf("}}\n");
+    } else {
+        printf("[%sBENCH%s] : allocations per run min %.0f, median %.0f, max %.0f\n", LMAGENTA BOLD, RESET,
+               mem.min, mem.median, mem.max);
+    }
+}
+
+compile_info_stats
+compile_bench(compile_options *options)
+{
+    compile_info_stats stats = {0};
+    File file = {0};
+    Lexer lexer = {0};
+    Parser parser = {0};
+    Checker checker = {0};
+
+    if (options->file_count == 0) {
+        options->st = ST_FILE;
+        log_error("No input files");
+        stats.status = FAILURE;
+        return stats;
+    }
+    if (options->file_count > 1) log_warn("--bench only runs the first input");
+    stats.file_count = 1;
+
+    if (compile_file_stage(options, &file, false) == FAILURE) {
+        stats.status = FAILURE;
+        return stats;
+    }
+
+    const uint runs = options->bench_runs;
+    f64 *walls[ST_COUNT] = {0};
+    for (Stage s = ST_LEXER; s < ST_COUNT; s++) {
+        walls[s] = mem_alloc(sizeof(f64) * runs);
+    }
+    f64 *allocs = mem_alloc(sizeof(f64) * runs);
+
+    stats.status = SUCCESS;
+    for (uint i = 0; i < options->bench_warmup + runs && stats.status == SUCCESS; i++)
+    {
+        compile_info_stats run = {0};
+        run.file_size = file.length;
+
+        const usize before = mem_allocation_count();
+        run.status = compile_source(options, &file, &lexer, &parser, &checker, nullptr, &run);
+        const usize after = mem_allocation_count();
+        stats = run;
+
+        if (i < options->bench_warmup) continue;
+        const uint at = i - options->bench_warmup;
+        for (Stage s = ST_LEXER; s < ST_COUNT; s++) {
+            walls[s][at] = run.stages[s].wall;
+        }
+        allocs[at] = (f64)(after - before);
+    }
+
+    if (stats.status == SUCCESS) bench_report(options, walls, allocs, &stats);
+
+    for (Stage s = ST_LEXER; s < ST_COUNT; s++) {
+        mem_free(walls[s]);
+    }
+    mem_free(allocs);
+    file_free(&file);
+    lexer_deinit(&lexer);
+    parser_deinit(&parser);
+    checker_deinit(&checker);
+    return stats;
+}
+
 internal void
 init_compile_options(compile_options *co, const i32 argc, i8 **argv)
 {
@@ -126,14 +698,138 @@ init_compile_options(compile_options *co, const i32 argc, i8 **argv)
     co->debug_info    = false;
     co->debug_symbols = false;
     co->timer         = false;
+    co->timer_json    = false;
     co->lex_only      = false;
+    co->jobs          = pool_cpu_count();
+    co->bench_runs    = 0;
+    co->bench_warmup  = 0;
     co->st            = ST_UNKNOWN;
-    co->filename      = argv[1];
+    co->filename      = nullptr;
+    co->files         = nullptr;
+    co->file_count    = 0;
+    co->include_dirs  = nullptr;
+    co->include_count = 0;
+    co->input_dirs    = nullptr;
+    co->input_dir_count = 0;
+    co->cache_dir     = nullptr;
+    co->server        = false;
+    co->client        = false;
+    co->shutdown      = false;
+    co->watch         = false;
+    co->socket_path   = SERVER_DEFAULT_SOCKET;
 }
 
 internal void
-parse_compile_argument(compile_options *co, cstr arg)
+compile_options_push_file(compile_options *co, cstr path)
 {
+    // capacity doubles whenever the count reaches a power of two
+    const uint count = co->file_count;
+    if ((count & (count - 1)) == 0) {
+        co->files = mem_resize(co->files, sizeof(char *) * (count ? count * 2 : 1));
+    }
+    co->files[co->file_count++] = string_dup(path, strlen(path));
+}
+
+#if !OS_WIN
+internal int
+compare_cstr(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// every .vr file below `dir`, sorted so a batch always runs in the same order
+internal void
+compile_options_add_dir(compile_options *co, cstr dir)
+{
+    DIR *d = opendir(dir);
+    if (!d) {
+        log_error("Unable to open input directory");
+        return;
+    }
+
+    const uint first = co->file_count;
+    const usize len  = strlen(dir);
+    cstr sep         = len && dir[len - 1] == '/' ? "" : "/";
+    char path[PATH_MAX];
+    struct dirent *entry;
+    while ((entry = readdir(d)))
+    {
+        cstr name = entry->d_name;
+        if (name[0] == '.') continue; // hidden files, `.` and `..`
+        if (snprintf(path, sizeof(path), "%s%s%s", dir, sep, name) >= (int)sizeof(path)) continue;
+
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+        const usize name_len = strlen(name);
+        if (S_ISDIR(st.st_mode)) compile_options_add_dir(co, path);
+        else if (name_len > 3 && !strcmp(name + name_len - 3, ".vr")) compile_options_push_file(co, path);
+    }
+    closedir(d);
+    if (co->file_count > first) qsort(co->files + first, co->file_count - first, sizeof(char *), compare_cstr);
+}
+#endif
+
+internal void
+compile_options_add_path(compile_options *co, cstr path)
+{
+#if !OS_WIN
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        co->input_dirs = mem_resize(co->input_dirs, sizeof(char *) * (co->input_dir_count + 1));
+        co->input_dirs[co->input_dir_count++] = string_dup(path, strlen(path));
+        compile_options_add_dir(co, path);
+        return;
+    }
+#endif
+    // a missing or non .vr file is reported when it is read
+    compile_options_push_file(co, path);
+}
+
+// a file, a directory or a glob the shell did not expand
+internal void
+compile_options_add_input(compile_options *co, cstr arg)
+{
+#if !OS_WIN
+    if (strpbrk(arg, "*?[")) {
+        glob_t g;
+        if (glob(arg, 0, nullptr, &g) == 0) {
+            for (usize i = 0; i < g.gl_pathc; i++) compile_options_add_path(co, g.gl_pathv[i]);
+        } else {
+            char message[PATH_MAX + 32];
+            snprintf(message, sizeof(message), "No file matches `%s`", arg);
+            log_warn(message);
+        }
+        globfree(&g);
+        return;
+    }
+#endif
+    compile_options_add_path(co, arg);
+}
+
+// value of a `--flag N` argument, advances past it
+internal uint
+parse_compile_count(compile_options *co, i32 *i)
+{
+    cstr flag = co->argv[*i];
+    if (*i + 1 >= co->argc) {
+        log_error_unknown_flag(flag);
+        return 0;
+    }
+
+    char *end        = nullptr;
+    cstr value       = co->argv[++*i];
+    const long count = strtol(value, &end, 10);
+    if (*end != '\0' || count < 1 || count > (long)RUINT_MAX) {
+        log_error_unknown_flag(value);
+        return 0;
+    }
+    return (uint)count;
+}
+
+internal void
+parse_compile_argument(compile_options *co, i32 *i)
+{
+    cstr arg = co->argv[*i];
     if (strcmp(arg, "--log") == 0) {
         co->debug_info = true;
     }
@@ -143,9 +839,61 @@ parse_compile_argument(compile_options *co, cstr arg)
     else if (strcmp(arg, "--timer") == 0) {
         co->timer = true;
     }
+    else if (strcmp(arg, "--json") == 0) {
+        co->timer      = true;
+        co->timer_json = true;
+    }
     else if (strcmp(arg, "--lex") == 0) {
         co->lex_only = true;
     }
+    else if (!strcmp(arg, "--jobs") || !strcmp(arg, "-j")) {
+        const uint jobs = parse_compile_count(co, i);
+        if (jobs) co->jobs = jobs;
+    }
+    else if (strcmp(arg, "--bench") == 0) {
+        co->bench_runs = parse_compile_count(co, i);
+    }
+    else if (strcmp(arg, "--warmup") == 0) {
+        co->bench_warmup = parse_compile_count(co, i);
+    }
+    else if (strcmp(arg, "--cache") == 0) {
+        co->cache_dir = CACHE_DEFAULT_DIR;
+    }
+    else if (strcmp(arg, "--cache-dir") == 0) {
+        if (*i + 1 >= co->argc) {
+            log_error_unknown_flag(arg);
+            return;
+        }
+        co->cache_dir = co->argv[++*i];
+    }
+    else if (strcmp(arg, "--server") == 0) {
+        co->server = true;
+    }
+    else if (strcmp(arg, "--client") == 0) {
+        co->client = true;
+    }
+    else if (strcmp(arg, "--shutdown") == 0) {
+        co->shutdown = true;
+    }
+    else if (strcmp(arg, "--watch") == 0) {
+        co->watch = true;
+    }
+    else if (strcmp(arg, "--socket") == 0) {
+        if (*i + 1 >= co->argc) {
+            log_error_unknown_flag(arg);
+            return;
+        }
+        co->socket_path = co->argv[++*i];
+    }
+    else if (!strcmp(arg, "-I") || !strcmp(arg, "--include")) {
+        if (*i + 1 >= co->argc) {
+            log_error_unknown_flag(arg);
+            return;
+        }
+        cstr dir = co->argv[++*i];
+        co->include_dirs = mem_resize(co->include_dirs, sizeof(char *) * (co->include_count + 1));
+        co->include_dirs[co->include_count++] = string_dup(dir, strlen(dir));
+    }
     else {
         log_error_unknown_flag(arg);
     }
@@ -157,19 +905,57 @@ compile_options_new(const i32 argc, i8 **argv)
     compile_options co;
     init_compile_options(&co, argc, argv);
 
-    for (i32 i = 2; i < argc; i++) {
-        parse_compile_argument(&co, argv[i]);
+    for (i32 i = 1; i < argc; i++) {
+        cstr arg = co.argv[i];
+        if (arg[0] == '-' && arg[1] != '\0') parse_compile_argument(&co, &i);
+        else compile_options_add_input(&co, arg);
     }
+    co.filename = co.file_count ? co.files[0] : nullptr;
 
     return co;
 }
 
+void
+compile_options_free(compile_options *co)
+{
+    for (uint i = 0; i < co->file_count; i++) {
+        mem_free(co->files[i]);
+    }
+    mem_free(co->files);
+    for (uint i = 0; i < co->include_count; i++) {
+        mem_free(co->include_dirs[i]);
+    }
+    mem_free(co->include_dirs);
+    co->include_dirs  = nullptr;
+    co->include_count = 0;
+    for (uint i = 0; i < co->input_dir_count; i++) {
+        mem_free(co->input_dirs[i]);
+    }
+    mem_free(co->input_dirs);
+    co->input_dirs      = nullptr;
+    co->input_dir_count = 0;
+    co->files      = nullptr;
+    co->file_count = 0;
+    co->filename   = nullptr;
+}
+
 void
 print_version_and_exit(void)
 {
     cstr out = " Rotate Compiler \n Version: %s\n"
+               " usage: rotate FILE|DIR|GLOB... [flags], several inputs compile in parallel\n"
                " --lex   for lexical analysis\n"
                " --log   for dumping compilation info as orgmode format in output.org\n"
+               " --jobs N  threads used for big files or many inputs (default: all cpus)\n"
+               " --timer for per stage timing, throughput and peak memory\n"
+               " --json  same as --timer, as json on stdout\n"
+               " -I DIR  load imported modules, searched next to the importer then in DIR (repeatable)\n"
+               " --cache  reuse tokens and trees of unchanged files from " CACHE_DEFAULT_DIR "/\n"
+               " --cache-dir DIR  same as --cache with another directory\n"
+               " --bench N [--warmup K]  compile N (+K untimed) times in process, report stage statistics\n"
+               " --server  serve compilations on " SERVER_DEFAULT_SOCKET " (or --socket PATH), unchanged files stay in memory\n"
+               " --client  compile through the server, in process when none runs (--shutdown stops it)\n"
+               " --watch  compile again whenever an input or a file importing it changes (linux)\n"
                " https://github.com/Airbus5717/rotate-c"
                "\n";
     fprintf(stdout, out, RTVERSION);
@@ -0,0 +1,222 @@
+#include "cache.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+#if !OS_WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define CACHE_MAGIC "RTCACHE"
+#define CACHE_ALIGN 16u
+
+typedef enum
+{
+    CS_KINDS,
+    CS_STARTS,
+    CS_LENGTHS,
+    CS_SYMS,
+    CS_LONGS,
+    CS_FLAT_KINDS,
+    CS_FLAT_TOKENS,
+    CS_FLAT_LHS,
+    CS_FLAT_RHS,
+    CS_FLAT_EXTRA,
+    CS_COUNT,
+} CacheSection;
+
+typedef struct
+{
+    char magic[8];
+    u64 key;
+    u32 format;
+    u32 source_length;
+    u32 node_count;
+    u32 flat_decls;
+    u64 sections[CS_COUNT]; // offset of every Array header
+} CacheHeader;
+
+internal const usize cache_elem_size[CS_COUNT] = {
+    [CS_KINDS] = sizeof(u8),       [CS_STARTS] = sizeof(uint),     [CS_LENGTHS] = sizeof(u8),
+    [CS_SYMS] = sizeof(uint),      [CS_LONGS] = sizeof(TknLong),   [CS_FLAT_KINDS] = sizeof(u8),
+    [CS_FLAT_TOKENS] = sizeof(uint), [CS_FLAT_LHS] = sizeof(uint), [CS_FLAT_RHS] = sizeof(uint),
+    [CS_FLAT_EXTRA] = sizeof(uint),
+};
+
+u64
+cache_key(const File *file)
+{
+    const u64 seed = hash_bytes(RTVERSION, sizeof(RTVERSION) - 1, CACHE_FORMAT);
+    return hash_bytes(file->contents, file->length, seed);
+}
+
+internal void
+cache_entry_path(char *path, usize size, cstr dir, u64 key)
+{
+    snprintf(path, size, "%s/%016llx.rtc", dir, (unsigned long long)key);
+}
+
+void
+cache_entry_free(CacheEntry *entry)
+{
+#if !OS_WIN
+    if (entry->base) munmap(entry->base, entry->size);
+#endif
+    *entry = (CacheEntry){0};
+}
+
+#if OS_WIN
+// NOTE(5717): no mapping on windows yet, every lookup misses
+bool
+cache_load(cstr dir, const File *file, CacheEntry *entry)
+{
+    UNUSED(dir), UNUSED(file);
+    *entry = (CacheEntry){0};
+    return false;
+}
+
+bool
+cache_store(cstr dir, const File *file, const Lexer *lexer, const Parser *parser)
+{
+    UNUSED(dir), UNUSED(file), UNUSED(lexer), UNUSED(parser);
+    return false;
+}
+#else
+
+// the section at `offset` lies inside the mapping
+internal bool
+cache_section_valid(const CacheEntry *entry, u64 offset, usize elem_size)
+{
+    if (offset % CACHE_ALIGN || offset + sizeof(Array_Header) > entry->size) return false;
+    const Array_Header *header = (const Array_Header *)((const u8 *)entry->base + offset);
+    return header->count == header->capacity &&
+           header->count <= (entry->size - offset - sizeof(Array_Header)) / elem_size;
+}
+
+bool
+cache_load(cstr dir, const File *file, CacheEntry *entry)
+{
+    *entry = (CacheEntry){0};
+
+    const u64 key = cache_key(file);
+    char path[PATH_MAX];
+    cache_entry_path(path, sizeof(path), dir, key);
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (usize)st.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        return false;
+    }
+    void *base = mmap(nullptr, (usize)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return false;
+
+    entry->base = base;
+    entry->size = (usize)st.st_size;
+
+    const CacheHeader *header = base;
+    bool usable = !memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) && header->key == key &&
+                  header->format == CACHE_FORMAT && header->source_length == file->length;
+    for (CacheSection s = 0; usable && s < CS_COUNT; s++)
+    {
+        usable = cache_section_valid(entry, header->sections[s], cache_elem_size[s]);
+    }
+    if (!usable) {
+        cache_entry_free(entry);
+        return false;
+    }
+
+#define CACHE_VIEW(T, s) ((Array(T))((u8 *)base + header->sections[(s)]))
+    entry->tokens = (TokenStream){
+        CACHE_VIEW(u8, CS_KINDS),  CACHE_VIEW(uint, CS_STARTS),   CACHE_VIEW(u8, CS_LENGTHS),
+        CACHE_VIEW(uint, CS_SYMS), CACHE_VIEW(TknLong, CS_LONGS),
+    };
+    entry->flat = (FlatAst){
+        CACHE_VIEW(u8, CS_FLAT_KINDS), CACHE_VIEW(uint, CS_FLAT_TOKENS), CACHE_VIEW(uint, CS_FLAT_LHS),
+        CACHE_VIEW(uint, CS_FLAT_RHS), CACHE_VIEW(uint, CS_FLAT_EXTRA),  header->flat_decls,
+    };
+#undef CACHE_VIEW
+    entry->node_count = header->node_count;
+    return true;
+}
+
+// count elements as an Array header plus the elements, padded to CACHE_ALIGN
+internal bool
+cache_write_section(FILE *out, u64 *offset, const void *elements, usize count, usize elem_size)
+{
+    static const u8 zeros[CACHE_ALIGN] = {0};
+    const Array_Header header          = {count, count};
+    const usize bytes                  = count * elem_size;
+    const usize pad                    = (CACHE_ALIGN - (sizeof(header) + bytes) % CACHE_ALIGN) % CACHE_ALIGN;
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    ok      = ok && (bytes == 0 || fwrite(elements, bytes, 1, out) == 1);
+    ok      = ok && (pad == 0 || fwrite(zeros, pad, 1, out) == 1);
+    *offset += sizeof(header) + bytes + pad;
+    return ok;
+}
+
+bool
+cache_store(cstr dir, const File *file, const Lexer *lexer, const Parser *parser)
+{
+    static uint cache_tmp_counter; // only touched with atomics
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) return false;
+
+    const u64 key = cache_key(file);
+    char path[PATH_MAX], tmp[PATH_MAX];
+    cache_entry_path(path, sizeof(path), dir, key);
+    const int n = snprintf(tmp, sizeof(tmp), "%s.%d.%u.tmp", path, (int)getpid(),
+                           __atomic_fetch_add(&cache_tmp_counter, 1u, __ATOMIC_RELAXED));
+    if (n < 0 || (usize)n >= sizeof(tmp)) return false;
+
+    FILE *out = fopen(tmp, "wb");
+    if (!out) return false;
+
+    FlatAst flat              = flat_ast_build(parser->ast, lexer);
+    const TokenStream *tokens = &lexer->tokens;
+    CacheHeader header        = {
+        .magic         = CACHE_MAGIC,
+        .key           = key,
+        .format        = CACHE_FORMAT,
+        .source_length = file->length,
+        .node_count    = parser->node_count,
+        .flat_decls    = flat.decls,
+    };
+
+    const struct
+    {
+        const void *elements;
+        usize count;
+    } arrays[CS_COUNT] = {
+        [CS_KINDS]       = {tokens->kinds->elements, array_count(tokens->kinds)},
+        [CS_STARTS]      = {tokens->starts->elements, array_count(tokens->starts)},
+        [CS_LENGTHS]     = {tokens->lengths->elements, array_count(tokens->lengths)},
+        [CS_SYMS]        = {tokens->syms->elements, array_count(tokens->syms)},
+        [CS_LONGS]       = {tokens->longs->elements, array_count(tokens->longs)},
+        [CS_FLAT_KINDS]  = {flat.kinds->elements, array_count(flat.kinds)},
+        [CS_FLAT_TOKENS] = {flat.tokens->elements, array_count(flat.tokens)},
+        [CS_FLAT_LHS]    = {flat.lhs->elements, array_count(flat.lhs)},
+        [CS_FLAT_RHS]    = {flat.rhs->elements, array_count(flat.rhs)},
+        [CS_FLAT_EXTRA]  = {flat.extra->elements, array_count(flat.extra)},
+    };
+
+    // the header is written again once the section offsets are known
+    u64 offset = sizeof(header);
+    bool ok    = fwrite(&header, sizeof(header), 1, out) == 1;
+    for (CacheSection s = 0; ok && s < CS_COUNT; s++)
+    {
+        header.sections[s] = offset;
+        ok = cache_write_section(out, &offset, arrays[s].elements, arrays[s].count, cache_elem_size[s]);
+    }
+    flat_ast_free(&flat);
+
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = fclose(out) == 0 && ok;
+    if (ok) ok = rename(tmp, path) == 0;
+    if (!ok) remove(tmp);
+    return ok;
+}
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "flat.h"
+#include "parser.h"
+
+// Parse cache
+// NOTE(5717): one file per distinct source text in the cache directory, named
+// after a 64 bit hash of the contents seeded with the compiler version. It
+// holds the packed token stream and the flat AST, every array laid out as its
+// Array header followed by the elements, so a hit maps the file and uses the
+// arrays in place. A hit is only read for imports and counts, token syms are
+// kept as lexed but the names and literals they index are not stored. Entries
+// are written under a temporary name and renamed, concurrent writers of the
+// same source are harmless.
+// Only files that check clean are stored and a hit skips the checker, bump
+// CACHE_FORMAT whenever the lexer, the parser, the checker or these layouts
+// change.
+#define CACHE_FORMAT 5u
+#define CACHE_DEFAULT_DIR ".rotate-cache"
+
+typedef struct
+{
+    void *base; // the mapping, nullptr when there is no entry
+    usize size;
+    TokenStream tokens; // read only views into the mapping, never grown or freed
+    FlatAst flat;
+    uint node_count; // parser node count of the run that stored it
+} CacheEntry;
+
+u64 cache_key(const File *);
+// maps the entry for the file contents, false on a miss
+bool cache_load(cstr dir, const File *, CacheEntry *);
+// saves the tokens and the tree of a successful parse, false when it could not
+bool cache_store(cstr dir, const File *, const Lexer *, const Parser *);
+void cache_entry_free(CacheEntry *);
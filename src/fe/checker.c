@@ -0,0 +1,1351 @@
+#include "checker.h"
+#include "../include/mem.h"
+#include "../include/arraylist.h"
+#include "../include/pool.h"
+
+#define CHECK_MIN_SLOTS 256u
+// errors past this many are counted, not printed
+#define CHECK_MAX_REPORTS 32u
+
+// globals are checked on first use, BS_BUSY while their initializer is
+typedef enum
+{
+    BS_NEW,
+    BS_BUSY,
+    BS_DONE,
+} BindState;
+
+// One thread's share of the checking
+// NOTE(5717): a worker owns the locals in scope, the types it makes and the
+// errors it finds, the Checker behind it is only read once the globals are
+// done. The serial passes over the globals run in a worker of their own.
+typedef struct
+{
+    Checker *checker;
+    SymTable locals;               // Sym -> index of its innermost local Binding
+    Array(Binding) bindings;       // locals of every open scope
+    Array(uint) scopes;            // bindings count when each open scope was pushed
+    TypeIndex ret;                 // return type of the function being checked
+    Array(TypeIndex) params;       // of the signature being checked
+    Array(CheckDiag) diags;
+    uint first, end;               // its functions, indices into the checked functions
+} CheckWorker;
+
+internal TypeIndex check_expr(CheckWorker *, AstExpr *);
+internal void check_stmt(CheckWorker *, AstStmt *);
+
+/*
+ *
+ * Symbol tables
+ *
+ */
+internal SymTable
+sym_table_make(uint capacity)
+{
+    uint slots = CHECK_MIN_SLOTS;
+    while (slots < capacity * 2) slots <<= 1;
+
+    SymTable t = {
+        .keys   = mem_alloc(sizeof(u64) * slots),
+        .values = mem_alloc(sizeof(uint) * slots),
+        .mask   = slots - 1,
+    };
+    memset(t.keys, 0, sizeof(u64) * slots);
+    return t;
+}
+
+internal void
+sym_table_free(SymTable *t)
+{
+    mem_free(t->keys);
+    mem_free(t->values);
+    *t = (SymTable){0};
+}
+
+internal void
+sym_table_clear(SymTable *t)
+{
+    memset(t->keys, 0, sizeof(u64) * (t->mask + 1));
+    t->count = 0;
+}
+
+// slot holding the key, or the empty slot where it would go
+internal inline uint
+sym_table_probe(const SymTable *t, u64 key)
+{
+    uint at = (uint)((key * 0x9E3779B97F4A7C15ull) >> 32) & t->mask;
+    while (t->keys[at] && t->keys[at] != key) at = (at + 1) & t->mask;
+    return at;
+}
+
+internal void
+sym_table_grow(SymTable *t)
+{
+    SymTable grown = sym_table_make((t->mask + 1));
+    for (uint i = 0; i <= t->mask; i++)
+    {
+        if (!t->keys[i]) continue;
+        const uint at    = sym_table_probe(&grown, t->keys[i]);
+        grown.keys[at]   = t->keys[i];
+        grown.values[at] = t->values[i];
+    }
+    grown.count = t->count;
+    sym_table_free(t);
+    *t = grown;
+}
+
+internal inline uint
+sym_table_get(const SymTable *t, u64 key)
+{
+    const uint at = sym_table_probe(t, key);
+    return t->keys[at] ? t->values[at] : CHECK_NONE;
+}
+
+// keys are never removed, CHECK_NONE is stored instead
+internal void
+sym_table_put(SymTable *t, u64 key, uint value)
+{
+    uint at = sym_table_probe(t, key);
+    if (!t->keys[at]) {
+        if ((t->count + 1) * 2 > t->mask + 1) {
+            sym_table_grow(t);
+            at = sym_table_probe(t, key);
+        }
+        t->keys[at] = key;
+        t->count++;
+    }
+    t->values[at] = value;
+}
+
+#define MEMBER_KEY(owner, member) (((u64)(owner) << 32) | (u64)(member))
+
+/*
+ *
+ * Scopes
+ * NOTE(5717): Checker.bindings are the globals in declaration order, one each
+ * even when the name is taken, log.c reads them. Locals may shadow anything,
+ * even a local of the same scope, a local that shadows no other falls back
+ * to the globals.
+ *
+ */
+internal CheckWorker
+check_worker_make(Checker *c)
+{
+    return (CheckWorker){
+        .checker     = c,
+        .locals      = sym_table_make(CHECK_MIN_SLOTS),
+        .bindings    = array_make(Binding, 64),
+        .scopes      = array_make(uint, 16),
+        .params      = array_make(TypeIndex, 8),
+        .diags       = array_make(CheckDiag, 4),
+    };
+}
+
+internal void
+check_worker_free(CheckWorker *w)
+{
+    sym_table_free(&w->locals);
+    array_free(w->bindings);
+    array_free(w->scopes);
+    array_free(w->params);
+    array_free(w->diags);
+}
+
+// the global Binding for `name`, bound to nothing when `name` is
+internal uint
+check_bind_global(Checker *c, Sym name, BindKind kind, TypeIndex type, AstDecl *decl)
+{
+    const uint index = (uint)array_count(c->bindings);
+    const Binding b  = {
+         .name     = name,
+         .kind     = (u8)kind,
+         .state    = type != TYPE_NONE ? BS_DONE : BS_NEW,
+         .shadowed = CHECK_NONE,
+         .type     = type,
+         .decl     = decl,
+    };
+    array_push(c->bindings, b);
+    if (name) sym_table_put(&c->names, name, index);
+    return index;
+}
+
+internal Binding *
+check_bind(CheckWorker *w, Sym name, BindKind kind, TypeIndex type, AstDecl *decl)
+{
+    if (!name) return nullptr;
+    const Binding b = {
+        .name     = name,
+        .kind     = (u8)kind,
+        .state    = BS_DONE,
+        .shadowed = sym_table_get(&w->locals, name),
+        .type     = type,
+        .decl     = decl,
+    };
+    sym_table_put(&w->locals, name, (uint)array_count(w->bindings));
+    array_push(w->bindings, b);
+    return &array_at(w->bindings, array_count(w->bindings) - 1);
+}
+
+// innermost Binding of `name`, nullptr when there is none
+internal Binding *
+check_lookup(CheckWorker *w, Sym name)
+{
+    uint index = sym_table_get(&w->locals, name);
+    if (index != CHECK_NONE) return &array_at(w->bindings, index);
+    index = sym_table_get(&w->checker->names, name);
+    return index == CHECK_NONE ? nullptr : &array_at(w->checker->bindings, index);
+}
+
+internal void
+check_scope_push(CheckWorker *w)
+{
+    array_push(w->scopes, (uint)array_count(w->bindings));
+}
+
+internal void
+check_scope_pop(CheckWorker *w)
+{
+    const uint mark = array_at(w->scopes, array_count(w->scopes) - 1);
+    array_count(w->scopes)--;
+    for (uint i = (uint)array_count(w->bindings); i-- > mark;)
+    {
+        const Binding *b = &array_at(w->bindings, i);
+        sym_table_put(&w->locals, b->name, b->shadowed);
+    }
+    array_count(w->bindings) = mark;
+}
+
+/*
+ *
+ * Types
+ *
+ */
+#define check_entry(c, type) type_entry(&(c)->types, (type))
+
+internal inline bool
+is_unknown(TypeIndex t)
+{
+    return t == BT_TBD;
+}
+
+internal inline bool
+is_number(TypeIndex t)
+{
+    switch (t)
+    {
+        case BT_Int:
+        case BT_UInt:
+        case BT_Float:
+        case BT_Char: return true;
+        default: return false;
+    }
+}
+
+// numbers convert to each other, an unknown type goes anywhere and an
+// array goes where an unsized array of its elements does
+internal bool
+check_assignable(const Checker *c, TypeIndex to, TypeIndex from)
+{
+    if (to == from || is_unknown(to) || is_unknown(from)) return true;
+    if (is_number(to) && is_number(from)) return true;
+
+    const TypeEntry *a = check_entry(c, to);
+    const TypeEntry *b = check_entry(c, from);
+    return a->kind == AST_TYPE_ARRAY && b->kind == AST_TYPE_ARRAY && a->count == TYPE_NO_SIZE && a->of == b->of;
+}
+
+internal cstr
+check_basic_name(BaseType base)
+{
+    switch (base)
+    {
+        case BT_Void: return "void";
+        case BT_Int: return "int";
+        case BT_UInt: return "uint";
+        case BT_Float: return "float";
+        case BT_Char: return "char";
+        case BT_Bool: return "bool";
+        case BT_TBD: return "unknown";
+        default: return "invalid";
+    }
+}
+
+internal void
+describe_append(char *buffer, usize size, usize *at, cstr text, usize length)
+{
+    if (*at + 1 >= size) return;
+    const usize room = size - *at - 1;
+    const usize n    = length < room ? length : room;
+    memcpy(buffer + *at, text, n);
+    *at += n;
+    buffer[*at] = '\0';
+}
+
+internal void
+check_describe(const Checker *c, TypeIndex t, char *buffer, usize size, usize *at)
+{
+    if (t == TYPE_NONE) {
+        describe_append(buffer, size, at, "-", 1);
+        return;
+    }
+    const TypeEntry *e = check_entry(c, t);
+    switch (e->kind)
+    {
+        case AST_TYPE_BASIC: {
+            const cstr name = check_basic_name(e->base);
+            describe_append(buffer, size, at, name, strlen(name));
+        } break;
+        case AST_TYPE_ARRAY: {
+            char dims[16] = "[]";
+            if (e->count != TYPE_NO_SIZE) snprintf(dims, sizeof(dims), "[%u]", e->count);
+            describe_append(buffer, size, at, dims, strlen(dims));
+            check_describe(c, e->of, buffer, size, at);
+        } break;
+        case AST_TYPE_FUNCTION:
+            describe_append(buffer, size, at, "fn(", 3);
+            for (uint i = 0; i < e->count; i++)
+            {
+                if (i) describe_append(buffer, size, at, ", ", 2);
+                check_describe(c, e->params[i], buffer, size, at);
+            }
+            describe_append(buffer, size, at, ")", 1);
+            if (e->of != BT_Void) {
+                describe_append(buffer, size, at, " ", 1);
+                check_describe(c, e->of, buffer, size, at);
+            }
+            break;
+        case AST_TYPE_STRUCT:
+        case AST_TYPE_ENUM:
+            describe_append(buffer, size, at, c->parser->lexer->file->contents + e->name.index, e->name.length);
+            break;
+        default: describe_append(buffer, size, at, "?", 1); break;
+    }
+}
+
+cstr
+checker_type_describe(const Checker *c, TypeIndex t, char *buffer, usize size)
+{
+    usize at  = 0;
+    buffer[0] = '\0';
+    check_describe(c, t, buffer, size, &at);
+    return buffer;
+}
+
+/*
+ *
+ * Error reporting
+ * NOTE(5717): checking goes on after an error, the offending expression gets
+ * the unknown type which matches anything so one mistake is reported once.
+ * Workers only record their errors, checker_check prints them sorted by
+ * position once every worker is done, so the output does not depend on the
+ * scheduling.
+ *
+ */
+internal TypeIndex
+check_report(CheckWorker *w, CheckErr error, Token at, cstr detail)
+{
+    CheckDiag diag = {.offset = at.index, .order = (uint)array_count(w->diags), .error = error};
+    if (detail) snprintf(diag.detail, sizeof(diag.detail), "%s", detail);
+    array_push(w->diags, diag);
+    return BT_TBD;
+}
+
+internal TypeIndex
+check_report_name(CheckWorker *w, CheckErr error, Token name)
+{
+    char detail[80];
+    snprintf(detail, sizeof(detail), "`%.*s`", (int)name.length,
+             w->checker->parser->lexer->file->contents + name.index);
+    return check_report(w, error, name, detail);
+}
+
+internal TypeIndex
+check_report_types(CheckWorker *w, CheckErr error, Token at, TypeIndex expected, TypeIndex found)
+{
+    char want[40], got[40], detail[96];
+    if (expected != TYPE_NONE) {
+        snprintf(detail, sizeof(detail), "expected `%s`, found `%s`",
+                 checker_type_describe(w->checker, expected, want, sizeof(want)),
+                 checker_type_describe(w->checker, found, got, sizeof(got)));
+    } else {
+        snprintf(detail, sizeof(detail), "found `%s`", checker_type_describe(w->checker, found, got, sizeof(got)));
+    }
+    return check_report(w, error, at, detail);
+}
+
+internal void
+check_print(const Checker *c, const CheckDiag *diag)
+{
+    File *file        = c->parser->lexer->file;
+    const FilePos pos = file_pos(file, diag->offset);
+
+    fprintf(log_output(), " > %s%s%s:%u:%u: %serror: %s%s%s%s%s\n", BOLD, WHITE, file->name, pos.line, pos.col, LRED,
+            LBLUE, checker_err_msg(diag->error), diag->detail[0] ? ": " : "", diag->detail, RESET);
+
+    // the offending line for context
+    uint _length = 0;
+    cstr text    = file_line_text(file, pos.line, &_length);
+    if (_length > 0) {
+        const uint num_line_digits = get_digits_from_number(pos.line);
+        fprintf(log_output(), "  %s%u%s | %.*s\n", LYELLOW, pos.line, RESET, _length, text);
+
+        // Print caret pointing to error column
+        fprintf(log_output(), "  %*c |%*c%s^%s\n", num_line_digits, ' ', pos.col, ' ', LRED, RESET);
+    }
+
+    fprintf(log_output(), " > Advice: %s%s\n", RESET, checker_err_advice(diag->error));
+}
+
+internal int
+check_diag_compare(const void *a, const void *b)
+{
+    const CheckDiag *x = a, *y = b;
+    if (x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+/*
+ *
+ * Constants
+ * NOTE(5717): an expression is evaluated after it is checked, a part with a
+ * type error has the unknown type and no value, so nothing is reported twice.
+ * A literal is decoded once, by the check that first meets it, into
+ * AstExpr.literal.constant. A unary or binary expression over literals and
+ * folded expressions only is folded: its value goes in AstExpr.folded, set
+ * on every check like AstExpr.type, and every later reader takes it from
+ * there instead of walking the operands again. The tree itself is left as
+ * parsed, flat.h and the parse cache describe the source. An expression naming a constant is
+ * evaluated but kept as written, a warm reparse may change that constant
+ * alone, its value is memoized in the constant's Binding instead, once per
+ * check.
+ *
+ */
+#define CONST_INT_OF(v)   ((ConstValue){.kind = CONST_INT, .i = (v)})
+#define CONST_FLOAT_OF(v) ((ConstValue){.kind = CONST_FLOAT, .f = (v)})
+#define CONST_BOOL_OF(v)  ((ConstValue){.kind = CONST_BOOL, .b = (v)})
+
+// fills literal.constant from the value the lexer decoded, false after reporting a literal that does not fit
+internal bool
+check_decode(CheckWorker *w, AstExpr *e)
+{
+    const Token token = e->literal.value;
+    const LitTable *t = &w->checker->parser->lexer->literals;
+    switch (token.type)
+    {
+        case Tkn_TrueLiteral:
+        case Tkn_FalseLiteral: e->literal.constant = CONST_BOOL_OF(token.type == Tkn_TrueLiteral); break;
+        case Tkn_CharLiteral: e->literal.constant = CONST_INT_OF((i64)lit_value(t, token.sym)->i.lo); break;
+        case Tkn_FloatLiteral: e->literal.constant = CONST_FLOAT_OF(lit_value(t, token.sym)->f); break;
+        case Tkn_IntegerLiteral: {
+            // decimal up to INT64_MAX, hex and binary up to 64 bits
+            cstr text           = w->checker->parser->lexer->file->contents + token.index;
+            const bool radix    = token.length >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'b');
+            const LitValue *lit = lit_value(t, token.sym);
+            if (lit->i.hi || (!radix && lit->i.lo > (u64)INT64_MAX)) {
+                check_report(w, CE_LITERAL_TOO_LARGE, token, nullptr);
+                return false;
+            }
+            e->literal.constant = CONST_INT_OF((i64)lit->i.lo);
+        } break;
+        default: break; // strings and nil have no value here
+    }
+    return true;
+}
+
+internal ConstValue check_eval(CheckWorker *, AstExpr *);
+
+internal ConstValue
+check_eval_unary(CheckWorker *w, AstExpr *e)
+{
+    const ConstValue value = check_eval(w, e->unary.operand);
+    switch (e->unary.operator.type)
+    {
+        case Tkn_Not: return value.kind == CONST_BOOL ? CONST_BOOL_OF(!value.b) : (ConstValue){0};
+        case Tkn_MinusOperator:
+            if (value.kind == CONST_INT) return CONST_INT_OF((i64)(0 - (u64)value.i));
+            if (value.kind == CONST_FLOAT) return CONST_FLOAT_OF(-value.f);
+            return (ConstValue){0};
+        case Tkn_PlusOperator: return value.kind == CONST_BOOL ? (ConstValue){0} : value;
+        default: return (ConstValue){0};
+    }
+}
+
+internal ConstValue
+check_eval_bools(TknType op, bool x, bool y)
+{
+    switch (op)
+    {
+        case Tkn_AndKeyword: return CONST_BOOL_OF(x && y);
+        case Tkn_OrKeyword: return CONST_BOOL_OF(x || y);
+        case Tkn_EqualEqual: return CONST_BOOL_OF(x == y);
+        case Tkn_NotEqual: return CONST_BOOL_OF(x != y);
+        default: return (ConstValue){0};
+    }
+}
+
+internal ConstValue
+check_eval_floats(TknType op, f64 x, f64 y)
+{
+    switch (op)
+    {
+        case Tkn_PlusOperator: return CONST_FLOAT_OF(x + y);
+        case Tkn_MinusOperator: return CONST_FLOAT_OF(x - y);
+        case Tkn_MultOperator: return CONST_FLOAT_OF(x * y);
+        case Tkn_DivOperator: return CONST_FLOAT_OF(x / y); // IEEE, no error
+        case Tkn_EqualEqual: return CONST_BOOL_OF(x == y);
+        case Tkn_NotEqual: return CONST_BOOL_OF(x != y);
+        case Tkn_Greater: return CONST_BOOL_OF(x > y);
+        case Tkn_GreaterEql: return CONST_BOOL_OF(x >= y);
+        case Tkn_Less: return CONST_BOOL_OF(x < y);
+        case Tkn_LessEql: return CONST_BOOL_OF(x <= y);
+        default: return (ConstValue){0};
+    }
+}
+
+// ints wrap around like the machine does, shifts take the low 6 bits
+internal ConstValue
+check_eval_ints(TknType op, i64 x, i64 y)
+{
+    const u64 a = (u64)x, b = (u64)y;
+    switch (op)
+    {
+        case Tkn_PlusOperator: return CONST_INT_OF((i64)(a + b));
+        case Tkn_MinusOperator: return CONST_INT_OF((i64)(a - b));
+        case Tkn_MultOperator: return CONST_INT_OF((i64)(a * b));
+        case Tkn_DivOperator: return CONST_INT_OF(y == -1 ? (i64)(0 - a) : x / y);
+        case Tkn_Mod: return CONST_INT_OF(y == -1 ? 0 : x % y);
+        case Tkn_BitwiseAnd: return CONST_INT_OF((i64)(a & b));
+        case Tkn_BitwiseOr: return CONST_INT_OF((i64)(a | b));
+        case Tkn_BitwiseXor: return CONST_INT_OF((i64)(a ^ b));
+        case Tkn_LeftShift: return CONST_INT_OF((i64)(a << (b & 63)));
+        case Tkn_RightShift: return CONST_INT_OF(x >> (b & 63));
+        case Tkn_EqualEqual: return CONST_BOOL_OF(x == y);
+        case Tkn_NotEqual: return CONST_BOOL_OF(x != y);
+        case Tkn_Greater: return CONST_BOOL_OF(x > y);
+        case Tkn_GreaterEql: return CONST_BOOL_OF(x >= y);
+        case Tkn_Less: return CONST_BOOL_OF(x < y);
+        case Tkn_LessEql: return CONST_BOOL_OF(x <= y);
+        default: return (ConstValue){0};
+    }
+}
+
+internal ConstValue
+check_eval_binary(CheckWorker *w, AstExpr *e)
+{
+    const ConstValue a = check_eval(w, e->binary.left);
+    const ConstValue b = check_eval(w, e->binary.right);
+    if (!a.kind || !b.kind) return (ConstValue){0};
+
+    const TknType op = e->binary.operator.type;
+    if (a.kind == CONST_BOOL || b.kind == CONST_BOOL) {
+        return a.kind == b.kind ? check_eval_bools(op, a.b, b.b) : (ConstValue){0};
+    }
+    if (a.kind == CONST_FLOAT || b.kind == CONST_FLOAT) {
+        return check_eval_floats(op, a.kind == CONST_FLOAT ? a.f : (f64)a.i, b.kind == CONST_FLOAT ? b.f : (f64)b.i);
+    }
+    if ((op == Tkn_DivOperator || op == Tkn_Mod) && b.i == 0) {
+        check_report(w, CE_DIVIDE_BY_ZERO, e->binary.operator, nullptr);
+        e->type = BT_TBD; // evaluated again, reported once
+        return (ConstValue){0};
+    }
+    return check_eval_ints(op, a.i, b.i);
+}
+
+// value of a checked expression, CONST_NONE when it is not constant
+internal ConstValue
+check_eval(CheckWorker *w, AstExpr *e)
+{
+    if (is_unknown(e->type)) return (ConstValue){0};
+    switch (e->kind)
+    {
+        case AST_EXPR_LITERAL: return e->literal.constant;
+        case AST_EXPR_IDENTIFIER: {
+            const Binding *b = check_lookup(w, e->identifier.name.sym);
+            return b && b->kind == BIND_CONSTANT && b->state == BS_DONE ? b->value : (ConstValue){0};
+        }
+        case AST_EXPR_UNARY:
+        case AST_EXPR_BINARY:
+            if (e->folded.kind) return e->folded;
+            return e->kind == AST_EXPR_UNARY ? check_eval_unary(w, e) : check_eval_binary(w, e);
+        default: return (ConstValue){0};
+    }
+}
+
+internal inline bool
+check_is_folded(const AstExpr *e)
+{
+    return e->kind == AST_EXPR_LITERAL || e->folded.kind;
+}
+
+// a unary or binary expression over literals and folded expressions is folded to its value
+internal void
+check_fold(CheckWorker *w, AstExpr *e)
+{
+    const bool unary = e->kind == AST_EXPR_UNARY;
+    if (unary ? !check_is_folded(e->unary.operand) :
+                !check_is_folded(e->binary.left) || !check_is_folded(e->binary.right)) {
+        return;
+    }
+    e->folded = check_eval(w, e);
+}
+
+// the size of `[N]T`, TYPE_NO_SIZE when N is not constant
+internal uint
+check_size(CheckWorker *w, AstExpr *size)
+{
+    const ConstValue value = check_eval(w, size);
+    if (!value.kind) return TYPE_NO_SIZE;
+    if (value.kind != CONST_INT || value.i < 0 || value.i >= (i64)TYPE_NO_SIZE) {
+        char detail[40];
+        check_report(w, CE_ARRAY_SIZE, size->token, const_value_describe(value, detail, sizeof(detail)));
+        return TYPE_NO_SIZE;
+    }
+    return (uint)value.i;
+}
+
+/*
+ *
+ * Declarations
+ *
+ */
+internal TypeIndex
+check_type(CheckWorker *w, AstType *type)
+{
+    Checker *c = w->checker;
+    switch (type->kind)
+    {
+        case AST_TYPE_BASIC: {
+            // named types share the node kind, the token tells them apart
+            if (type->token.type != Tkn_Identifier) {
+                const BaseType base = type->basic.base_type;
+                return base >= BT_Void && base <= BT_Bool ? (TypeIndex)base : BT_TBD;
+            }
+            const Token name = type->user_defined.name;
+            const Binding *b = check_lookup(w, name.sym);
+            if (!b) return check_report_name(w, CE_UNKNOWN_TYPE, name);
+            if (b->kind != BIND_TYPE) return check_report_name(w, CE_NOT_A_TYPE, name);
+            return b->type;
+        }
+        case AST_TYPE_ARRAY: {
+            uint size = TYPE_NO_SIZE;
+            if (type->array.size) {
+                const TypeIndex of = check_expr(w, type->array.size);
+                if (!is_number(of) && !is_unknown(of)) {
+                    check_report_types(w, CE_EXPECTED_NUMBER, type->array.size->token, TYPE_NONE, of);
+                } else {
+                    size = check_size(w, type->array.size);
+                }
+            }
+            return type_array(&c->types, check_type(w, type->array.element_type), size);
+        }
+        default: return BT_TBD;
+    }
+}
+
+internal TypeIndex
+check_signature(CheckWorker *w, AstDecl *decl)
+{
+    array_count(w->params) = 0;
+    for_each(decl->function.parameters, param)
+    {
+        AstType *declared    = (*param)->variable.type;
+        const TypeIndex type = declared ? check_type(w, declared) : BT_TBD;
+        array_push(w->params, type);
+    }
+    const TypeIndex ret = decl->function.return_type ? check_type(w, decl->function.return_type) : BT_Void;
+    return type_function(&w->checker->types, w->params->elements, (uint)array_count(w->params), ret);
+}
+
+// the declared type, else the type of the initializer
+internal TypeIndex
+check_variable(CheckWorker *w, AstDecl *decl)
+{
+    const TypeIndex declared = decl->variable.type ? check_type(w, decl->variable.type) : TYPE_NONE;
+    if (!decl->variable.initializer) return declared != TYPE_NONE ? declared : BT_TBD;
+
+    const TypeIndex value = check_expr(w, decl->variable.initializer);
+    if (declared == TYPE_NONE) return value;
+    if (!check_assignable(w->checker, declared, value)) {
+        check_report_types(w, CE_MISMATCHED_TYPES, decl->variable.initializer->token, declared, value);
+    }
+    return declared;
+}
+
+// every global is BS_DONE before the first body is checked, then this only reads
+internal TypeIndex
+check_global(CheckWorker *w, Binding *b, Token use)
+{
+    if (b->state == BS_DONE) return b->type;
+    if (b->state == BS_BUSY) return check_report_name(w, CE_DEPENDS_ON_ITSELF, use);
+
+    b->state = BS_BUSY;
+    b->type  = check_variable(w, b->decl); // globals never move once declared
+    AstExpr *initializer = b->decl->variable.initializer;
+    if (b->kind == BIND_CONSTANT && initializer) b->value = check_eval(w, initializer);
+    b->state = BS_DONE;
+    return b->type;
+}
+
+/*
+ *
+ * Expressions
+ *
+ */
+internal TypeIndex
+check_literal(CheckWorker *w, AstExpr *e)
+{
+    if (!e->literal.constant.kind && !check_decode(w, e)) return BT_TBD;
+    switch (e->literal.value.type)
+    {
+        case Tkn_IntegerLiteral: return BT_Int;
+        case Tkn_FloatLiteral: return BT_Float;
+        case Tkn_CharLiteral: return BT_Char;
+        case Tkn_StringLiteral: return w->checker->string;
+        case Tkn_TrueLiteral:
+        case Tkn_FalseLiteral: return BT_Bool;
+        default: return BT_TBD; // nil
+    }
+}
+
+internal TypeIndex
+check_identifier(CheckWorker *w, const AstExpr *e)
+{
+    const Token name = e->identifier.name;
+    Binding *b       = check_lookup(w, name.sym);
+    if (!b) return check_report_name(w, CE_UNDECLARED, name);
+
+    switch ((BindKind)b->kind)
+    {
+        case BIND_TYPE: return check_report_name(w, CE_NOT_A_VALUE, name);
+        case BIND_VALUE:
+        case BIND_CONSTANT: return check_global(w, b, name);
+        default: return b->type;
+    }
+}
+
+internal TypeIndex
+check_operand(CheckWorker *w, AstExpr *operand, bool want_bool)
+{
+    TypeIndex type = check_expr(w, operand);
+    if (is_unknown(type)) return type;
+    if (want_bool && type != BT_Bool) {
+        return check_report_types(w, CE_EXPECTED_BOOL, operand->token, BT_Bool, type);
+    }
+    if (!want_bool && !is_number(type)) {
+        return check_report_types(w, CE_EXPECTED_NUMBER, operand->token, TYPE_NONE, type);
+    }
+    return type;
+}
+
+internal TypeIndex
+check_binary(CheckWorker *w, AstExpr *e)
+{
+    AstExpr *left         = e->binary.left;
+    AstExpr *right        = e->binary.right;
+    switch (e->binary.operator.type)
+    {
+        case Tkn_AndKeyword:
+        case Tkn_OrKeyword:
+            check_operand(w, left, true);
+            check_operand(w, right, true);
+            return BT_Bool;
+
+        case Tkn_EqualEqual:
+        case Tkn_NotEqual: {
+            TypeIndex a = check_expr(w, left);
+            TypeIndex b = check_expr(w, right);
+            if (!check_assignable(w->checker, a, b)) check_report_types(w, CE_MISMATCHED_TYPES, right->token, a, b);
+            return BT_Bool;
+        }
+
+        case Tkn_Greater:
+        case Tkn_GreaterEql:
+        case Tkn_Less:
+        case Tkn_LessEql:
+            check_operand(w, left, false);
+            check_operand(w, right, false);
+            return BT_Bool;
+
+        case Tkn_DotDot: {
+            TypeIndex a = check_operand(w, left, false);
+            check_operand(w, right, false);
+            return a;
+        }
+
+        default: {
+            // arithmetic is float when either side is, int otherwise
+            TypeIndex a = check_operand(w, left, false);
+            TypeIndex b = check_operand(w, right, false);
+            if (is_unknown(a) || is_unknown(b)) return BT_TBD;
+            if (a == BT_Float || b == BT_Float) return BT_Float;
+            return a == b ? a : BT_Int;
+        }
+    }
+}
+
+internal TypeIndex
+check_call(CheckWorker *w, AstExpr *e)
+{
+    const TypeIndex callee       = check_expr(w, e->call.callee);
+    const TypeEntry *function    = check_entry(w->checker, callee);
+    const Array(AstExprPtr) args = e->call.arguments;
+    const usize count            = args ? array_count(args) : 0;
+
+    if (function->kind != AST_TYPE_FUNCTION) {
+        if (!is_unknown(callee)) check_report_types(w, CE_NOT_CALLABLE, e->call.callee->token, TYPE_NONE, callee);
+        for (usize i = 0; i < count; i++) check_expr(w, array_at(args, i));
+        return BT_TBD;
+    }
+
+    const usize params = function->count;
+    if (count != params) {
+        char detail[64];
+        snprintf(detail, sizeof(detail), "expected %llu, found %llu", params, count);
+        check_report(w, CE_ARGUMENT_COUNT, e->call.callee->token, detail);
+    }
+    for (usize i = 0; i < count; i++)
+    {
+        AstExpr *arg  = array_at(args, i);
+        const TypeIndex type  = check_expr(w, arg);
+        if (i >= params) continue;
+        const TypeIndex param = function->params[i];
+        if (!check_assignable(w->checker, param, type)) {
+            check_report_types(w, CE_MISMATCHED_TYPES, arg->token, param, type);
+        }
+    }
+    return function->of;
+}
+
+internal TypeIndex
+check_member(CheckWorker *w, AstExpr *e)
+{
+    Checker *c       = w->checker;
+    AstExpr *object  = e->member.object;
+    const Token name = e->member.member;
+
+    // members of an imported module are not known here
+    if (object->kind == AST_EXPR_IDENTIFIER) {
+        const Binding *b = check_lookup(w, object->identifier.name.sym);
+        if (b && b->kind == BIND_IMPORT) {
+            object->type = BT_TBD;
+            return BT_TBD;
+        }
+    }
+
+    const TypeIndex type = check_expr(w, object);
+    if (is_unknown(type)) return type;
+    const TypeEntry *entry = check_entry(c, type);
+    if (entry->kind == AST_TYPE_STRUCT) {
+        const uint index = sym_table_get(&c->members, MEMBER_KEY(entry->name.sym, name.sym));
+        if (index != CHECK_NONE) return array_at(c->member_types, index);
+    }
+    return check_report_name(w, CE_NO_FIELD, name);
+}
+
+// `E::M` parses as a `::` assignment to the enum name, TYPE_NONE for anything else
+internal TypeIndex
+check_enum_member(CheckWorker *w, AstExpr *e)
+{
+    AstExpr *target = e->assign.target;
+    AstExpr *value  = e->assign.value;
+    if (target->kind != AST_EXPR_IDENTIFIER || value->kind != AST_EXPR_IDENTIFIER) return TYPE_NONE;
+
+    const Binding *b = check_lookup(w, target->identifier.name.sym);
+    if (!b || b->kind != BIND_TYPE) return TYPE_NONE;
+    const TypeEntry *entry = check_entry(w->checker, b->type);
+    if (entry->kind != AST_TYPE_ENUM) return TYPE_NONE;
+
+    const TypeIndex type = b->type;
+    target->type         = type;
+    value->type          = type;
+    const u64 key        = MEMBER_KEY(entry->name.sym, value->identifier.name.sym);
+    if (sym_table_get(&w->checker->members, key) == CHECK_NONE) {
+        return check_report_name(w, CE_NO_MEMBER, value->identifier.name);
+    }
+    return type;
+}
+
+// `name := value` and `name :: value` in a body, the next char tells them apart
+internal bool
+check_is_constant(const Checker *c, Token colon)
+{
+    const File *file = c->parser->lexer->file;
+    uint at          = colon.index + 1;
+    while (at < file->length && (file->contents[at] == ' ' || file->contents[at] == '\t')) at++;
+    return at < file->length && file->contents[at] == ':';
+}
+
+internal TypeIndex
+check_assign(CheckWorker *w, AstExpr *e)
+{
+    AstExpr *target = e->assign.target;
+    AstExpr *value  = e->assign.value;
+    const Token op  = e->assign.operator;
+
+    if (op.type == Tkn_Colon) {
+        const bool constant = check_is_constant(w->checker, op);
+        if (constant) {
+            const TypeIndex member = check_enum_member(w, e);
+            if (member != TYPE_NONE) return member;
+        }
+        const TypeIndex type = check_expr(w, value);
+        if (target->kind != AST_EXPR_IDENTIFIER) return check_report(w, CE_NOT_ASSIGNABLE, target->token, nullptr);
+        target->type   = type;
+        const Sym name = target->identifier.name.sym;
+        Binding *b     = check_bind(w, name, constant ? BIND_CONSTANT : BIND_VALUE, type, nullptr);
+        if (b && constant) b->value = check_eval(w, value);
+        return type;
+    }
+
+    const TypeIndex to = check_expr(w, target);
+    if (target->kind == AST_EXPR_IDENTIFIER) {
+        const Binding *b = check_lookup(w, target->identifier.name.sym);
+        if (b && b->kind != BIND_VALUE) check_report_name(w, CE_NOT_ASSIGNABLE, target->identifier.name);
+    } else if (target->kind != AST_EXPR_MEMBER) {
+        check_report(w, CE_NOT_ASSIGNABLE, target->token, nullptr);
+    }
+
+    const TypeIndex from = op.type == Tkn_Equal ? check_expr(w, value) : check_operand(w, value, false);
+    if (op.type != Tkn_Equal && !is_number(to) && !is_unknown(to)) {
+        check_report_types(w, CE_EXPECTED_NUMBER, target->token, TYPE_NONE, to);
+    } else if (!check_assignable(w->checker, to, from)) {
+        check_report_types(w, CE_MISMATCHED_TYPES, value->token, to, from);
+    }
+    return to;
+}
+
+internal TypeIndex
+check_expr_kind(CheckWorker *w, AstExpr *e)
+{
+    switch (e->kind)
+    {
+        case AST_EXPR_LITERAL: return check_literal(w, e);
+        case AST_EXPR_IDENTIFIER: return check_identifier(w, e);
+        case AST_EXPR_BINARY: return check_binary(w, e);
+        case AST_EXPR_UNARY:
+            if (e->unary.operator.type == Tkn_Not) {
+                check_operand(w, e->unary.operand, true);
+                return BT_Bool;
+            }
+            return check_operand(w, e->unary.operand, false);
+        case AST_EXPR_CALL: return check_call(w, e);
+        case AST_EXPR_MEMBER: return check_member(w, e);
+        case AST_EXPR_ASSIGN: return check_assign(w, e);
+        default: return BT_TBD;
+    }
+}
+
+internal TypeIndex
+check_expr(CheckWorker *w, AstExpr *e)
+{
+    e->folded = (ConstValue){0}; // a warm check may meet it again after its operands changed
+    e->type   = check_expr_kind(w, e);
+    if (e->kind == AST_EXPR_UNARY || e->kind == AST_EXPR_BINARY) check_fold(w, e);
+    return e->type;
+}
+
+/*
+ *
+ * Statements
+ *
+ */
+internal void
+check_condition(CheckWorker *w, AstExpr *condition)
+{
+    if (condition) check_operand(w, condition, true);
+}
+
+internal void
+check_for(CheckWorker *w, AstStmt *s)
+{
+    check_scope_push(w);
+    AstStmt *init = s->for_stmt.init;
+    if (init && init->kind == AST_STMT_DECL && !init->decl.declaration->variable.initializer) {
+        // `for i in range`, i takes the type of the range bounds or array elements
+        const TypeIndex range  = check_expr(w, s->for_stmt.condition);
+        const TypeEntry *entry = check_entry(w->checker, range);
+        const TypeIndex type   = entry->kind == AST_TYPE_ARRAY ? entry->of : range;
+        check_bind(w, init->decl.declaration->variable.name.sym, BIND_VALUE, type, init->decl.declaration);
+    } else {
+        if (init) check_stmt(w, init);
+        check_condition(w, s->for_stmt.condition);
+        if (s->for_stmt.update) check_stmt(w, s->for_stmt.update);
+    }
+    check_stmt(w, s->for_stmt.body);
+    check_scope_pop(w);
+}
+
+internal void
+check_return(CheckWorker *w, AstStmt *s)
+{
+    AstExpr *value = s->return_stmt.value;
+    if (!value) {
+        if (w->ret != BT_Void && !is_unknown(w->ret)) {
+            check_report_types(w, CE_MISSING_RETURN_VALUE, s->token, w->ret, BT_Void);
+        }
+        return;
+    }
+    const TypeIndex type = check_expr(w, value);
+    if (w->ret == BT_Void) check_report_types(w, CE_UNEXPECTED_RETURN_VALUE, value->token, TYPE_NONE, type);
+    else if (!check_assignable(w->checker, w->ret, type)) {
+        check_report_types(w, CE_MISMATCHED_TYPES, value->token, w->ret, type);
+    }
+}
+
+internal void
+check_stmt(CheckWorker *w, AstStmt *s)
+{
+    if (!s) return;
+    switch (s->kind)
+    {
+        case AST_STMT_EXPR: check_expr(w, s->expr.expression); break;
+        case AST_STMT_DECL: {
+            AstDecl *decl        = s->decl.declaration;
+            const TypeIndex type = check_variable(w, decl);
+            const bool constant  = decl->variable.is_constant;
+            AstExpr *initializer = decl->variable.initializer;
+            const BindKind kind  = constant ? BIND_CONSTANT : BIND_VALUE;
+            Binding *b           = check_bind(w, decl->variable.name.sym, kind, type, decl);
+            if (b && constant && initializer) b->value = check_eval(w, initializer);
+        } break;
+        case AST_STMT_IF:
+            check_condition(w, s->if_stmt.condition);
+            check_stmt(w, s->if_stmt.then_stmt);
+            check_stmt(w, s->if_stmt.else_stmt);
+            break;
+        case AST_STMT_WHILE:
+            check_condition(w, s->while_stmt.condition);
+            check_stmt(w, s->while_stmt.body);
+            break;
+        case AST_STMT_FOR: check_for(w, s); break;
+        case AST_STMT_RETURN: check_return(w, s); break;
+        case AST_STMT_DEFER: check_stmt(w, s->defer_stmt.statement); break;
+        case AST_STMT_BLOCK:
+            check_scope_push(w);
+            for_each(s->block.statements, stmt) check_stmt(w, *stmt);
+            check_scope_pop(w);
+            break;
+        default: break;
+    }
+}
+
+internal void
+check_function(CheckWorker *w, AstDecl *decl, TypeIndex type)
+{
+    const TypeEntry *signature = check_entry(w->checker, type);
+    check_scope_push(w);
+    for (usize i = 0; i < array_count(decl->function.parameters); i++)
+    {
+        AstDecl *param = array_at(decl->function.parameters, i);
+        check_bind(w, param->variable.name.sym, BIND_VALUE, signature->params[i], param);
+    }
+    w->ret = signature->of;
+    check_stmt(w, decl->function.body);
+    check_scope_pop(w);
+}
+
+/*
+ *
+ * Checker
+ * NOTE(5717): the globals come first and serially: every global name is
+ * bound, then struct fields and function signatures get their types, then
+ * the global initializers are checked, a use of a global while its own
+ * initializer is being checked is a cycle. So declaration order does not
+ * matter. Function bodies then only read the globals and are checked in
+ * batches on the pool, batches of about the same number of AST nodes
+ * (Parser.spans) so a thread picking up the next batch finds work of the
+ * same size. Small programs are checked as one batch on the calling thread.
+ *
+ */
+#define CHECK_PARALLEL_MIN_NODES (1u << 16)
+#define CHECK_BATCHES_PER_JOB    8u
+
+typedef struct
+{
+    Checker *checker;
+    CheckWorker *workers;
+    Array(AstDeclPtr) decls;
+    const uint *functions; // index into decls of every function
+} CheckBodies;
+
+internal void
+check_bodies_task(void *ctx, uint batch)
+{
+    CheckBodies *bodies = ctx;
+    CheckWorker *w      = &bodies->workers[batch];
+    for (uint i = w->first; i < w->end; i++)
+    {
+        const uint decl = bodies->functions[i];
+        check_function(w, array_at(bodies->decls, decl), array_at(bodies->checker->bindings, decl).type);
+    }
+}
+
+Checker
+checker_init(Parser *p)
+{
+    Checker c = {
+        .parser       = p,
+        .names        = sym_table_make(CHECK_MIN_SLOTS),
+        .members      = sym_table_make(CHECK_MIN_SLOTS),
+        .bindings     = array_make(Binding, 64),
+        .member_types = array_make(TypeIndex, 64),
+    };
+    type_table_init(&c.types);
+    return c;
+}
+
+void
+checker_deinit(Checker *c)
+{
+    type_table_free(&c->types);
+    sym_table_free(&c->names);
+    sym_table_free(&c->members);
+    array_free(c->bindings);
+    array_free(c->member_types);
+    *c = (Checker){0};
+}
+
+internal void
+checker_reset(Checker *c)
+{
+    type_table_clear(&c->types);
+    sym_table_clear(&c->names);
+    sym_table_clear(&c->members);
+    array_count(c->bindings)     = 0;
+    array_count(c->member_types) = 0;
+    c->error_count               = 0;
+    c->string                    = type_array(&c->types, BT_Char, TYPE_NO_SIZE);
+}
+
+internal Token
+check_decl_name(const AstDecl *decl)
+{
+    switch (decl->kind)
+    {
+        case AST_DECL_IMPORT: return decl->import.alias;
+        case AST_DECL_FUNCTION: return decl->function.name;
+        case AST_DECL_VARIABLE: return decl->variable.name;
+        case AST_DECL_STRUCT: return decl->struct_decl.name;
+        case AST_DECL_ENUM: return decl->enum_decl.name;
+        default: return (Token){0};
+    }
+}
+
+// binds a top-level declaration, its fields and members
+internal void
+check_declare(CheckWorker *w, AstDecl *decl)
+{
+    Checker *c       = w->checker;
+    const Token name = check_decl_name(decl);
+    // the first declaration keeps the name, a later one is bound to nothing
+    Sym sym = name.sym;
+    if (sym && sym_table_get(&c->names, sym) != CHECK_NONE) {
+        check_report_name(w, CE_REDECLARED, name);
+        sym = SYM_NONE;
+    }
+
+    uint index = CHECK_NONE;
+    switch (decl->kind)
+    {
+        case AST_DECL_IMPORT: index = check_bind_global(c, sym, BIND_IMPORT, BT_TBD, decl); break;
+        case AST_DECL_FUNCTION: index = check_bind_global(c, sym, BIND_FUNCTION, BT_TBD, decl); break;
+        case AST_DECL_VARIABLE:
+            index = check_bind_global(c, sym, decl->variable.is_constant ? BIND_CONSTANT : BIND_VALUE, TYPE_NONE, decl);
+            break;
+        case AST_DECL_STRUCT:
+        case AST_DECL_ENUM: {
+            const bool is_enum   = decl->kind == AST_DECL_ENUM;
+            const uint self      = (uint)array_count(c->bindings);
+            const TypeIndex type = type_named(&c->types, is_enum ? AST_TYPE_ENUM : AST_TYPE_STRUCT, self, name);
+            index                = check_bind_global(c, sym, BIND_TYPE, type, decl);
+            if (!sym) break; // its members would mix with the first one's
+
+            const Array(AstDeclPtr) members = is_enum ? decl->enum_decl.members : decl->struct_decl.fields;
+            for (usize i = 0; i < array_count(members); i++)
+            {
+                const Token member = array_at(members, i)->variable.name;
+                const u64 key      = MEMBER_KEY(name.sym, member.sym);
+                if (sym_table_get(&c->members, key) != CHECK_NONE) {
+                    check_report_name(w, is_enum ? CE_DUPLICATE_MEMBER : CE_DUPLICATE_FIELD, member);
+                    continue;
+                }
+                sym_table_put(&c->members, key, (uint)array_count(c->member_types));
+                array_push(c->member_types, is_enum ? type : BT_TBD); // fields see below
+            }
+        } break;
+        default: index = check_bind_global(c, SYM_NONE, BIND_VALUE, BT_TBD, decl); break;
+    }
+    array_at(c->bindings, index).name = name.sym; // for the log, only the table decides what a name means
+}
+
+internal void
+check_globals(CheckWorker *w, const Array(AstDeclPtr) decls)
+{
+    Checker *c        = w->checker;
+    const usize count = array_count(decls);
+    for (usize i = 0; i < count; i++) check_declare(w, array_at(decls, i));
+
+    for (usize i = 0; i < count; i++)
+    {
+        AstDecl *decl = array_at(decls, i);
+        if (decl->kind == AST_DECL_FUNCTION) {
+            array_at(c->bindings, i).type = check_signature(w, decl);
+        } else if (decl->kind == AST_DECL_STRUCT) {
+            const Sym owner = decl->struct_decl.name.sym;
+            const bool kept = sym_table_get(&c->names, owner) == i;
+            for_each(decl->struct_decl.fields, field)
+            {
+                const TypeIndex type = check_type(w, (*field)->variable.type);
+                if (!kept) continue;
+                const uint index = sym_table_get(&c->members, MEMBER_KEY(owner, (*field)->variable.name.sym));
+                array_at(c->member_types, index) = type;
+            }
+        }
+    }
+
+    for (usize i = 0; i < count; i++)
+    {
+        const AstDecl *decl = array_at(decls, i);
+        if (decl->kind == AST_DECL_VARIABLE) check_global(w, &array_at(c->bindings, i), decl->variable.name);
+    }
+}
+
+// splits the functions into batches of about `weight / n` nodes, returns how many
+internal uint
+check_split(const Parser *p, const Array(AstDeclPtr) decls, const uint *functions, uint count,
+            CheckWorker *workers, uint n)
+{
+    // spans count the nodes of every declaration, when they describe this tree
+    const bool weighed = p->spans && array_count(p->spans) == array_count(decls);
+    u64 total          = 0;
+    for (uint i = 0; i < count; i++) total += weighed ? array_at(p->spans, functions[i]).nodes : 1;
+
+    uint found = 0;
+    u64 seen   = 0;
+    for (uint i = 0; i < count; found++)
+    {
+        workers[found].first = i;
+        const u64 goal       = total * (found + 1) / n;
+        do {
+            seen += weighed ? array_at(p->spans, functions[i]).nodes : 1;
+            i++;
+        } while (i < count && seen < goal);
+        workers[found].end = i;
+    }
+    return found;
+}
+
+u8
+checker_check(Checker *c, uint jobs)
+{
+    checker_reset(c);
+    const AstProgram *program = c->parser->ast;
+    if (!program || !program->declarations) return SUCCESS;
+    const Array(AstDeclPtr) decls = program->declarations;
+
+    CheckWorker globals = check_worker_make(c);
+    check_globals(&globals, decls);
+
+    // bodies only read what the globals left in the checker
+    uint *functions = mem_alloc(sizeof(uint) * (array_count(decls) + 1));
+    uint count      = 0;
+    for (uint i = 0; i < array_count(decls); i++)
+    {
+        if (array_at(decls, i)->kind == AST_DECL_FUNCTION) functions[count++] = i;
+    }
+
+    uint made = 1;
+    if (jobs > 1 && c->parser->node_count >= CHECK_PARALLEL_MIN_NODES) made = jobs * CHECK_BATCHES_PER_JOB;
+    if (made > count) made = count ? count : 1;
+    CheckWorker *workers = mem_alloc(sizeof(CheckWorker) * made);
+    for (uint i = 0; i < made; i++) workers[i] = check_worker_make(c);
+    const uint n = count ? check_split(c->parser, decls, functions, count, workers, made) : 0;
+
+    CheckBodies bodies = {c, workers, decls, functions};
+    pool_run(jobs, n, check_bodies_task, &bodies);
+
+    // every error in source order, as if one thread had found them all
+    Array(CheckDiag) diags = array_make(CheckDiag, 16);
+    for_each(globals.diags, diag) array_push(diags, *diag);
+    for (uint i = 0; i < n; i++)
+    {
+        for_each(workers[i].diags, diag) array_push(diags, *diag);
+    }
+    for (usize i = 0; i < array_count(diags); i++) array_at(diags, i).order = (uint)i;
+    qsort(diags->elements, array_count(diags), sizeof(CheckDiag), check_diag_compare);
+
+    c->error_count = (uint)array_count(diags);
+    for (uint i = 0; i < c->error_count && i < CHECK_MAX_REPORTS; i++) check_print(c, &array_at(diags, i));
+    if (c->error_count > CHECK_MAX_REPORTS) {
+        fprintf(log_output(), " > %s%u more type errors not shown%s\n", LRED, c->error_count - CHECK_MAX_REPORTS,
+                RESET);
+    }
+
+    for (uint i = 0; i < made; i++) check_worker_free(&workers[i]);
+    check_worker_free(&globals);
+    mem_free(workers);
+    mem_free(functions);
+    array_free(diags);
+    return c->error_count ? FAILURE : SUCCESS;
+}
+
+cstr
+checker_err_msg(const CheckErr error)
+{
+    switch (error)
+    {
+        case CE_UNKNOWN: return "Unknown type error";
+        case CE_UNDECLARED: return "Undeclared name";
+        case CE_REDECLARED: return "Name declared twice";
+        case CE_UNKNOWN_TYPE: return "Unknown type";
+        case CE_NOT_A_TYPE: return "Not a type";
+        case CE_NOT_A_VALUE: return "Type used as a value";
+        case CE_NOT_CALLABLE: return "Not a function";
+        case CE_ARGUMENT_COUNT: return "Wrong number of arguments";
+        case CE_MISMATCHED_TYPES: return "Mismatched types";
+        case CE_EXPECTED_BOOL: return "Expected bool";
+        case CE_EXPECTED_NUMBER: return "Expected number";
+        case CE_NO_FIELD: return "No such field";
+        case CE_NO_MEMBER: return "No such enum member";
+        case CE_NOT_ASSIGNABLE: return "Cannot assign";
+        case CE_MISSING_RETURN_VALUE: return "Missing return value";
+        case CE_UNEXPECTED_RETURN_VALUE: return "Function returns nothing";
+        case CE_DEPENDS_ON_ITSELF: return "Initializer depends on itself";
+        case CE_DUPLICATE_FIELD: return "Duplicate struct field";
+        case CE_DUPLICATE_MEMBER: return "Duplicate enum member";
+        case CE_DIVIDE_BY_ZERO: return "Division by zero in a constant expression";
+        case CE_LITERAL_TOO_LARGE: return "Integer literal too large";
+        case CE_ARRAY_SIZE: return "Invalid array size";
+        default: return "Unknown error";
+    }
+}
+
+cstr
+checker_err_advice(const CheckErr error)
+{
+    switch (error)
+    {
+        case CE_UNDECLARED: return "Declare the name before using it, or check its spelling";
+        case CE_REDECLARED: return "Rename one of the declarations";
+        case CE_UNKNOWN_TYPE: return "Declare a struct or enum with this name, or use a builtin type";
+        case CE_NOT_A_TYPE: return "Only struct and enum names can be used as types";
+        case CE_NOT_A_VALUE: return "Struct and enum names are types, use a value of the type instead";
+        case CE_NOT_CALLABLE: return "Only functions can be called";
+        case CE_ARGUMENT_COUNT: return "Pass one argument per parameter of the function";
+        case CE_MISMATCHED_TYPES: return "Make both sides the same type";
+        case CE_EXPECTED_BOOL: return "Compare the value to get a bool, e.g. `x != 0`";
+        case CE_EXPECTED_NUMBER: return "Arithmetic and ordering work on int, uint, float and char";
+        case CE_NO_FIELD: return "Check the struct declaration for the field name";
+        case CE_NO_MEMBER: return "Check the enum declaration for the member name";
+        case CE_NOT_ASSIGNABLE: return "Only variables and struct fields can be assigned, constants cannot";
+        case CE_MISSING_RETURN_VALUE: return "Return a value of the function's return type";
+        case CE_UNEXPECTED_RETURN_VALUE: return "Add a return type to the function or drop the value";
+        case CE_DEPENDS_ON_ITSELF: return "Break the cycle between the initializers";
+        case CE_DUPLICATE_FIELD: return "Rename or remove one of the fields";
+        case CE_DUPLICATE_MEMBER: return "Rename or remove one of the members";
+        case CE_DIVIDE_BY_ZERO: return "The divisor evaluates to zero at compile time";
+        case CE_LITERAL_TOO_LARGE: return "Decimal literals fit in 63 bits, hex and binary ones in 64";
+        case CE_ARRAY_SIZE: return "Array sizes are non-negative integer constants";
+        default: return "Check the types of the expression";
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "parser.h"
+
+typedef enum
+{
+    CE_UNKNOWN,
+    CE_UNDECLARED,
+    CE_REDECLARED,
+    CE_UNKNOWN_TYPE,
+    CE_NOT_A_TYPE,
+    CE_NOT_A_VALUE,
+    CE_NOT_CALLABLE,
+    CE_ARGUMENT_COUNT,
+    CE_MISMATCHED_TYPES,
+    CE_EXPECTED_BOOL,
+    CE_EXPECTED_NUMBER,
+    CE_NO_FIELD,
+    CE_NO_MEMBER,
+    CE_NOT_ASSIGNABLE,
+    CE_MISSING_RETURN_VALUE,
+    CE_UNEXPECTED_RETURN_VALUE,
+    CE_DEPENDS_ON_ITSELF,
+    CE_DUPLICATE_FIELD,
+    CE_DUPLICATE_MEMBER,
+    CE_DIVIDE_BY_ZERO,
+    CE_LITERAL_TOO_LARGE,
+    CE_ARRAY_SIZE,
+} CheckErr;
+
+// Type checker
+// NOTE(5717): names resolve through open addressing tables keyed by the Sym
+// the lexer interned, every lookup is one probe sequence. A table maps a Sym
+// to its innermost Binding, each Binding remembers the one it shadows, so a
+// scope is only a mark into a bindings stack: popping it walks the bindings
+// above the mark back into the table. Globals have their own table, filled
+// before any body is checked and only read afterwards, so function bodies
+// are checked in parallel, each batch of them with its own table of locals.
+// Struct fields and enum members live in a table keyed by (owner Sym,
+// member Sym). Types are interned in the checker's TypeTable (type.h), two
+// types are the same when their TypeIndex is, AstExpr.type holds one until
+// the next check.
+typedef struct
+{
+    u64 *keys; // 0 for an empty slot
+    uint *values;
+    uint mask, count;
+} SymTable;
+
+typedef enum
+{
+    BIND_VALUE,
+    BIND_CONSTANT,
+    BIND_FUNCTION,
+    BIND_TYPE,
+    BIND_IMPORT,
+} BindKind;
+
+typedef struct
+{
+    Sym name;
+    u8 kind;          // BindKind
+    u8 state;         // globals are resolved on first use, see checker.c
+    uint shadowed;    // binding of the same table the name meant before, CHECK_NONE if none
+    TypeIndex type;   // TYPE_NONE until resolved
+    ConstValue value; // of a constant, once resolved
+    AstDecl *decl;
+} Binding;
+
+generate_array_type(Binding);
+
+#define CHECK_NONE RUINT_MAX
+
+// one error, printed once every body is checked
+typedef struct
+{
+    uint offset; // file offset of the offending token
+    uint order;  // ties at one offset keep the order they were found in
+    CheckErr error;
+    char detail[96];
+} CheckDiag;
+
+generate_array_type(CheckDiag);
+
+typedef struct Checker
+{
+    Parser *parser;
+    TypeTable types;               // BT_TBD stands for a type the checker cannot know
+    SymTable names;                // Sym -> index of its global Binding
+    SymTable members;              // owner and member Sym -> index into member_types
+    Array(Binding) bindings;       // one per top-level declaration, in order
+    Array(TypeIndex) member_types;
+    TypeIndex string;
+    uint error_count;
+} Checker;
+
+Checker checker_init(Parser *);
+// checks the parser's tree with function bodies spread over `jobs` threads,
+// every error is reported in source order and FAILURE returned
+u8 checker_check(Checker *, uint jobs);
+void checker_deinit(Checker *);
+
+// readable spelling of a checked type, TYPE_NONE is spelled `-`
+cstr checker_type_describe(const Checker *, TypeIndex, char *buffer, usize size);
+
+// Error handling functions
+cstr checker_err_msg(const CheckErr error);
+cstr checker_err_advice(const CheckErr error);
@@ -0,0 +1,371 @@
+#include "flat.h"
+
+// NOTE(5717): flattening walks the pointer tree once, parents are appended
+// before their children so a node row can be filled in after its subtrees
+// exist. Runs are collected on a scratch stack first so that nested lists
+// do not interleave in `extra`.
+
+typedef struct
+{
+    FlatAst *f;
+    const Lexer *lexer;
+    Array(uint) scratch;
+    usize hint; // token found by the previous lookup
+} FlatBuilder;
+
+internal NodeIdx flat_decl(FlatBuilder *, const AstDecl *);
+internal NodeIdx flat_stmt(FlatBuilder *, const AstStmt *);
+internal NodeIdx flat_expr(FlatBuilder *, const AstExpr *);
+internal NodeIdx flat_type(FlatBuilder *, const AstType *);
+
+// tokens are sorted by offset, so the AST token copy maps back to its index
+// NOTE(5717): consecutive lookups land close together, so the binary search
+// runs over a window galloped out from the previous hit
+internal TknIdx
+flat_find_token(FlatBuilder *b, Token tkn)
+{
+    // a zeroed Token was never set, identifiers are never empty
+    if (tkn.length == 0 && tkn.type == Tkn_Identifier) return FLAT_NONE;
+
+    const TokenStream *tokens = &b->lexer->tokens;
+    const usize count         = tkn_count(tokens);
+    usize lo = 0, hi = count;
+    if (b->hint < count)
+    {
+        usize step = 1;
+        if (tkn_start(tokens, b->hint) < tkn.index)
+        {
+            lo = b->hint + 1;
+            while (lo + step < count && tkn_start(tokens, lo + step) < tkn.index) lo += step, step <<= 1;
+            if (lo + step < count) hi = lo + step;
+        }
+        else
+        {
+            hi = b->hint;
+            while (hi >= step && tkn_start(tokens, hi - step) >= tkn.index) hi -= step, step <<= 1;
+            lo = hi >= step ? hi - step + 1 : 0;
+        }
+    }
+    while (lo < hi)
+    {
+        const usize mid = lo + (hi - lo) / 2;
+        if (tkn_start(tokens, mid) < tkn.index) lo = mid + 1;
+        else hi = mid;
+    }
+    // zero length terminators may share the offset of the next token
+    for (usize i = lo; i < count && tkn_start(tokens, i) == tkn.index; i++)
+    {
+        if (tkn_kind(tokens, i) == tkn.type)
+        {
+            b->hint = i;
+            return (TknIdx)i;
+        }
+    }
+    return FLAT_NONE;
+}
+
+internal NodeIdx
+flat_node(FlatBuilder *b, AstNodeType kind, Token tkn)
+{
+    FlatAst *f = b->f;
+    array_push(f->kinds, (u8)kind);
+    array_push(f->tokens, flat_find_token(b, tkn));
+    array_push(f->lhs, FLAT_NONE);
+    array_push(f->rhs, FLAT_NONE);
+    return (NodeIdx)(array_count(f->kinds) - 1);
+}
+
+// moves scratch[mark..] into extra as `count, idx...`, returns the run start
+internal uint
+flat_run_end(FlatBuilder *b, usize mark)
+{
+    FlatAst *f       = b->f;
+    const uint start = (uint)array_count(f->extra);
+    const usize n    = array_count(b->scratch) - mark;
+    array_push(f->extra, (uint)n);
+    array_append(f->extra, b->scratch->elements + mark, n);
+    b->scratch->count = mark;
+    return start;
+}
+
+internal uint
+flat_decl_run(FlatBuilder *b, const Array(AstDeclPtr) decls)
+{
+    const usize mark = array_count(b->scratch);
+    if (decls)
+    {
+        for (usize i = 0; i < array_count(decls); i++)
+        {
+            const NodeIdx child = flat_decl(b, array_at(decls, i));
+            array_push(b->scratch, child);
+        }
+    }
+    return flat_run_end(b, mark);
+}
+
+internal NodeIdx
+flat_decl(FlatBuilder *b, const AstDecl *decl)
+{
+    if (!decl) return FLAT_NONE;
+
+    FlatAst *f = b->f;
+    NodeIdx n  = FLAT_NONE;
+    switch (decl->kind)
+    {
+        case AST_DECL_IMPORT: {
+            n = flat_node(b, decl->kind, decl->import.alias);
+            flat_lhs(f, n) = flat_find_token(b, decl->import.module_path);
+            break;
+        }
+        case AST_DECL_FUNCTION: {
+            n                    = flat_node(b, decl->kind, decl->function.name);
+            const NodeIdx ret    = flat_type(b, decl->function.return_type);
+            const NodeIdx body   = flat_stmt(b, decl->function.body);
+            const uint params    = flat_decl_run(b, decl->function.parameters);
+            array_push(f->extra, ret); // right after the parameter run
+            flat_lhs(f, n) = params;
+            flat_rhs(f, n) = body;
+            break;
+        }
+        case AST_DECL_VARIABLE: {
+            n                  = flat_node(b, decl->kind, decl->variable.name);
+            const NodeIdx type = flat_type(b, decl->variable.type);
+            const NodeIdx init = flat_expr(b, decl->variable.initializer);
+            flat_lhs(f, n)     = type;
+            flat_rhs(f, n)     = init;
+            break;
+        }
+        case AST_DECL_STRUCT: {
+            n                    = flat_node(b, decl->kind, decl->struct_decl.name);
+            const uint fields    = flat_decl_run(b, decl->struct_decl.fields);
+            flat_lhs(f, n)       = fields;
+            break;
+        }
+        case AST_DECL_ENUM: {
+            n                    = flat_node(b, decl->kind, decl->enum_decl.name);
+            const uint members   = flat_decl_run(b, decl->enum_decl.members);
+            flat_lhs(f, n)       = members;
+            break;
+        }
+        default: UNREACHABLE(); break;
+    }
+    return n;
+}
+
+internal NodeIdx
+flat_stmt(FlatBuilder *b, const AstStmt *stmt)
+{
+    if (!stmt) return FLAT_NONE;
+
+    FlatAst *f      = b->f;
+    const NodeIdx n = flat_node(b, stmt->kind, stmt->token);
+    switch (stmt->kind)
+    {
+        case AST_STMT_EXPR: {
+            const NodeIdx expr = flat_expr(b, stmt->expr.expression);
+            flat_lhs(f, n)     = expr;
+            break;
+        }
+        case AST_STMT_DECL: {
+            const NodeIdx decl = flat_decl(b, stmt->decl.declaration);
+            flat_lhs(f, n)     = decl;
+            break;
+        }
+        case AST_STMT_IF: {
+            const NodeIdx cond  = flat_expr(b, stmt->if_stmt.condition);
+            const NodeIdx then  = flat_stmt(b, stmt->if_stmt.then_stmt);
+            const NodeIdx other = flat_stmt(b, stmt->if_stmt.else_stmt);
+            flat_lhs(f, n)      = cond;
+            flat_rhs(f, n)      = (uint)array_count(f->extra);
+            array_push(f->extra, then);
+            array_push(f->extra, other);
+            break;
+        }
+        case AST_STMT_WHILE: {
+            const NodeIdx cond = flat_expr(b, stmt->while_stmt.condition);
+            const NodeIdx body = flat_stmt(b, stmt->while_stmt.body);
+            flat_lhs(f, n)     = cond;
+            flat_rhs(f, n)     = body;
+            break;
+        }
+        case AST_STMT_FOR: {
+            const NodeIdx init   = flat_stmt(b, stmt->for_stmt.init);
+            const NodeIdx cond   = flat_expr(b, stmt->for_stmt.condition);
+            const NodeIdx update = flat_stmt(b, stmt->for_stmt.update);
+            const NodeIdx body   = flat_stmt(b, stmt->for_stmt.body);
+            flat_lhs(f, n)       = (uint)array_count(f->extra);
+            flat_rhs(f, n)       = body;
+            array_push(f->extra, init);
+            array_push(f->extra, cond);
+            array_push(f->extra, update);
+            break;
+        }
+        case AST_STMT_RETURN: {
+            const NodeIdx value = flat_expr(b, stmt->return_stmt.value);
+            flat_lhs(f, n)      = value;
+            break;
+        }
+        case AST_STMT_BREAK: break;
+        case AST_STMT_DEFER: {
+            const NodeIdx deferred = flat_stmt(b, stmt->defer_stmt.statement);
+            flat_lhs(f, n)         = deferred;
+            break;
+        }
+        case AST_STMT_BLOCK: {
+            const usize mark = array_count(b->scratch);
+            if (stmt->block.statements)
+            {
+                for (usize i = 0; i < array_count(stmt->block.statements); i++)
+                {
+                    const NodeIdx child = flat_stmt(b, array_at(stmt->block.statements, i));
+                    array_push(b->scratch, child);
+                }
+            }
+            const uint run = flat_run_end(b, mark);
+            flat_lhs(f, n) = run;
+            break;
+        }
+        default: UNREACHABLE(); break;
+    }
+    return n;
+}
+
+internal NodeIdx
+flat_expr(FlatBuilder *b, const AstExpr *expr)
+{
+    if (!expr) return FLAT_NONE;
+
+    FlatAst *f      = b->f;
+    const NodeIdx n = flat_node(b, expr->kind, expr->token);
+    switch (expr->kind)
+    {
+        case AST_EXPR_LITERAL:
+        case AST_EXPR_IDENTIFIER: break;
+        case AST_EXPR_BINARY: {
+            const NodeIdx left  = flat_expr(b, expr->binary.left);
+            const NodeIdx right = flat_expr(b, expr->binary.right);
+            flat_lhs(f, n)      = left;
+            flat_rhs(f, n)      = right;
+            break;
+        }
+        case AST_EXPR_UNARY: {
+            const NodeIdx operand = flat_expr(b, expr->unary.operand);
+            flat_lhs(f, n)        = operand;
+            break;
+        }
+        case AST_EXPR_CALL: {
+            const NodeIdx callee = flat_expr(b, expr->call.callee);
+            const usize mark     = array_count(b->scratch);
+            if (expr->call.arguments)
+            {
+                for (usize i = 0; i < array_count(expr->call.arguments); i++)
+                {
+                    const NodeIdx arg = flat_expr(b, array_at(expr->call.arguments, i));
+                    array_push(b->scratch, arg);
+                }
+            }
+            const uint args = flat_run_end(b, mark);
+            flat_lhs(f, n)  = callee;
+            flat_rhs(f, n)  = args;
+            break;
+        }
+        case AST_EXPR_MEMBER: {
+            const NodeIdx object = flat_expr(b, expr->member.object);
+            flat_lhs(f, n)       = object;
+            break;
+        }
+        case AST_EXPR_ASSIGN: {
+            const NodeIdx target = flat_expr(b, expr->assign.target);
+            const NodeIdx value  = flat_expr(b, expr->assign.value);
+            flat_lhs(f, n)       = target;
+            flat_rhs(f, n)       = value;
+            break;
+        }
+        default: UNREACHABLE(); break;
+    }
+    return n;
+}
+
+internal NodeIdx
+flat_type(FlatBuilder *b, const AstType *type)
+{
+    if (!type) return FLAT_NONE;
+
+    FlatAst *f      = b->f;
+    const NodeIdx n = flat_node(b, type->kind, type->token);
+    switch (type->kind)
+    {
+        case AST_TYPE_BASIC:
+            // NOTE(5717): user_defined.name overlaps basic.base_type
+            flat_lhs(f, n) = type->token.type == Tkn_Identifier ? BT_Id : type->basic.base_type;
+            break;
+        case AST_TYPE_ARRAY: {
+            const NodeIdx element = flat_type(b, type->array.element_type);
+            const NodeIdx size    = flat_expr(b, type->array.size);
+            flat_lhs(f, n)        = element;
+            flat_rhs(f, n)        = size;
+            break;
+        }
+        case AST_TYPE_FUNCTION: {
+            const NodeIdx ret = flat_type(b, type->function.return_type);
+            const usize mark  = array_count(b->scratch);
+            if (type->function.param_types)
+            {
+                for (usize i = 0; i < array_count(type->function.param_types); i++)
+                {
+                    const NodeIdx param = flat_type(b, array_at(type->function.param_types, i));
+                    array_push(b->scratch, param);
+                }
+            }
+            const uint params = flat_run_end(b, mark);
+            flat_lhs(f, n)    = params;
+            flat_rhs(f, n)    = ret;
+            break;
+        }
+        case AST_TYPE_STRUCT:
+        case AST_TYPE_ENUM: break;
+        default: UNREACHABLE(); break;
+    }
+    return n;
+}
+
+FlatAst
+flat_ast_build(const AstProgram *program, const Lexer *lexer)
+{
+    ASSERT_NULL(program, "flattening a missing AST");
+
+    // roughly one node per two tokens
+    const usize guess = tkn_count(&lexer->tokens) / 2 + 16;
+    FlatAst flat      = {
+        .kinds  = array_make(u8, guess),
+        .tokens = array_make(uint, guess),
+        .lhs    = array_make(uint, guess),
+        .rhs    = array_make(uint, guess),
+        .extra  = array_make(uint, guess / 2),
+        .decls  = FLAT_NONE,
+    };
+    FlatBuilder b = {&flat, lexer, array_make(uint, 64), 0};
+
+    flat.decls = flat_decl_run(&b, program->declarations);
+
+    array_free(b.scratch);
+    return flat;
+}
+
+void
+flat_ast_free(FlatAst *f)
+{
+    array_free(f->kinds);
+    array_free(f->tokens);
+    array_free(f->lhs);
+    array_free(f->rhs);
+    array_free(f->extra);
+    *f = (FlatAst){0};
+}
+
+usize
+flat_ast_size(const FlatAst *f)
+{
+    const usize row = sizeof(u8) + sizeof(TknIdx) + 2 * sizeof(uint);
+    return array_count(f->kinds) * row + array_count(f->extra) * sizeof(uint);
+}
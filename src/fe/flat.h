@@ -0,0 +1,69 @@
+#pragma once
+
+#include "lexer.h"
+#include "type.h"
+
+// Flat AST
+// NOTE(5717): same tree as AstProgram but every node is a row in parallel
+// arrays addressed by a NodeIdx, no pointers and no Token copies. A row is
+// {kind, token, lhs, rhs} (13 bytes), children that do not fit in lhs/rhs
+// live in `extra` as runs of `count, idx...` and lhs/rhs hold the run start.
+// Because it is only indices it can be written out and mapped back as is.
+//
+// per kind layout (tkn is the main token, ~ means FLAT_NONE):
+//   DECL_IMPORT      tkn alias (or ~)   lhs module path tkn
+//   DECL_FUNCTION    tkn name           lhs run(params) + return type   rhs body
+//   DECL_VARIABLE    tkn name           lhs type         rhs initializer
+//   DECL_STRUCT      tkn name           lhs run(fields)
+//   DECL_ENUM        tkn name           lhs run(members)
+//   STMT_EXPR        tkn                lhs expr
+//   STMT_DECL        tkn                lhs decl
+//   STMT_IF          tkn                lhs condition    rhs extra[then, else]
+//   STMT_WHILE       tkn                lhs condition    rhs body
+//   STMT_FOR         tkn                lhs extra[init, condition, update]  rhs body
+//   STMT_RETURN      tkn                lhs value
+//   STMT_DEFER       tkn                lhs statement
+//   STMT_BLOCK       tkn                lhs run(statements)
+//   EXPR_LITERAL     tkn value
+//   EXPR_IDENTIFIER  tkn name
+//   EXPR_BINARY      tkn operator       lhs left         rhs right
+//   EXPR_UNARY       tkn operator       lhs operand
+//   EXPR_CALL        tkn                lhs callee       rhs run(arguments)
+//   EXPR_MEMBER      tkn member         lhs object
+//   EXPR_ASSIGN      tkn operator       lhs target       rhs value
+//   TYPE_BASIC       tkn                lhs BaseType (BT_Id for user types)
+//   TYPE_ARRAY       tkn                lhs element      rhs size
+//   TYPE_FUNCTION    tkn                lhs run(params)  rhs return type
+
+typedef uint NodeIdx;
+
+#define FLAT_NONE RUINT_MAX // absent child or token
+
+typedef struct
+{
+    Array(u8) kinds;    // AstNodeType
+    Array(uint) tokens; // TknIdx into the lexer token array
+    Array(uint) lhs;
+    Array(uint) rhs;
+    Array(uint) extra;
+    uint decls; // run of top level declarations in extra
+} FlatAst;
+
+FlatAst flat_ast_build(const AstProgram *, const Lexer *);
+void flat_ast_free(FlatAst *);
+usize flat_ast_size(const FlatAst *); // bytes used by the node rows and extra
+
+#define flat_count(f)     array_count((f)->kinds)
+#define flat_kind(f, n)   ((AstNodeType)array_at((f)->kinds, (n)))
+#define flat_token(f, n)  array_at((f)->tokens, (n))
+#define flat_lhs(f, n)    array_at((f)->lhs, (n))
+#define flat_rhs(f, n)    array_at((f)->rhs, (n))
+#define flat_extra(f, at) array_at((f)->extra, (at))
+
+// children of a run stored in extra at `at`
+static inline const NodeIdx *
+flat_run(const FlatAst *f, uint at, uint *count)
+{
+    *count = array_at(f->extra, at);
+    return f->extra->elements + at + 1;
+}
@@ -1,5 +1,7 @@
 #include "lexer.h"
+#include "scan.h"
 #include "token.h"
+#include "../include/pool.h"
 
 // PRIVATE LEXER METHODS
 internal u8 lex_director(Lexer *);
@@ -16,23 +18,80 @@ internal void lex_save_state(Lexer *);
 internal void lex_restore_state_for_err(Lexer *);
 internal u8 lex_report_error(Lexer *l);
 internal u8 lex_add_token(Lexer *, TknType);
+internal uint lex_literal(Lexer *, TknType);
 internal void lex_advance(Lexer *);
 internal void lex_advance_len_inc(Lexer *);
 internal void lex_advance_len_times(Lexer *);
 internal char lex_peek(Lexer *);
 internal char lex_past(Lexer *);
 internal char lex_current(Lexer *);
+internal cstr lex_ptr(Lexer *);
 internal bool lex_is_not_eof(Lexer *);
 internal void lex_skip_whitespace(Lexer *);
-internal bool lex_keyword_match(Lexer *, cstr, uint);
+internal TknType lex_keyword(Lexer *);
 internal u8 lex_add_terminator(Lexer *);
 internal u8 lex_nested_comments(Lexer *);
 internal void log_lexer_state(Lexer *);
+internal u8 lex_run(Lexer *);
 
 // Constants
 #define MAX_IDENTIFIER_LENGTH 100
 #define MAX_NUMBER_LENGTH 100
 #define MAX_STRING_LENGTH (RUINT_MAX / 2)
+// first guess of the token count for a source of n bytes
+#define TOKENS_GUESS(n) ((n) / 4 + 16)
+// and of the distinct names in it
+#define NAMES_GUESS(n) ((n) / 256 + 64)
+// and of the literals in it
+#define LITERALS_GUESS(n) ((n) / 32 + 16)
+
+// chunked lexing, files below the minimum are lexed on one thread
+#define LEX_PARALLEL_MIN_LENGTH (8u << 20)
+#define LEX_CHUNK_MIN_LENGTH    (1u << 20)
+
+/*
+ *
+ * Keyword perfect hash
+ * NOTE(5717): the hash of (first char, last char, length) is collision free
+ * over TKN_KEYWORDS, a collision overrides an entry of the table below and
+ * -Woverride-init is made an error there, pick new multipliers if that ever
+ * happens
+ *
+ */
+#define KW_MIN_LENGTH 2u
+#define KW_MAX_LENGTH 8u
+#define KW_TABLE_SIZE 64u
+#define KW_HASH(first, last, len)                                                                  \
+    ((((uint)(u8)(first)) * 3u + (uint)(u8)(last) + (uint)(len) * 14u) & (KW_TABLE_SIZE - 1))
+
+typedef struct
+{
+    char text[KW_MAX_LENGTH]; // zero padded spelling
+    TknType type;
+} Keyword;
+
+#define KW_ENTRY(str, first, last, tkn)                                                            \
+    [KW_HASH(first, last, sizeof(str) - 1)] = {str, tkn},
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Woverride-init"
+internal const Keyword keyword_table[KW_TABLE_SIZE] = {TKN_KEYWORDS(KW_ENTRY)};
+#pragma GCC diagnostic pop
+
+#undef KW_ENTRY
+
+// keyword_masks[n] keeps the first n bytes of an 8 byte load
+internal const u8 keyword_masks[KW_MAX_LENGTH + 1][KW_MAX_LENGTH] = {
+    {0},
+    {0xFF},
+    {0xFF, 0xFF},
+    {0xFF, 0xFF, 0xFF},
+    {0xFF, 0xFF, 0xFF, 0xFF},
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+};
 
 // Lexer API
 // file must not be null and l owns the file ptr
@@ -40,104 +99,426 @@ Lexer
 lexer_init(File *file)
 {
     ASSERT_NULL(file, "Lexer File passed is a null pointer");
+#ifdef DEBUG
+#define KW_CHECK(str, first, last, tkn)                                                            \
+    ASSERT(str[0] == first && str[sizeof(str) - 2] == last, "bad keyword entry: " str);
+    TKN_KEYWORDS(KW_CHECK)
+#undef KW_CHECK
+#endif
     Lexer l          = {0};
     l.index          = 0;
     l.len            = 0;
-    l.line           = 1;
     l.file_length    = file ? file->length : 0;
+    l.end            = l.file_length;
     l.file           = file;
     l.error          = LE_UNKNOWN;
-    l.begin_tkn_line = 1;
-    l.save_line      = 1;
     l.save_index     = 0;
-    l.tokens         = array_make(Token, file->length / 4);
+    l.tokens         = tkn_stream_make(TOKENS_GUESS(file->length));
+    l.interner       = intern_make(NAMES_GUESS(file->length));
+    l.literals       = lit_table_make(LITERALS_GUESS(file->length));
     l.prev           = Tkn_EOT;
-
-    ASSERT_NULL(l.tokens, "Lexer vec of tokens passed is a null pointer");
     return l;
 }
 
 void
 lexer_deinit(Lexer *l)
 {
-    array_free(l->tokens);
+    tkn_stream_free(&l->tokens);
+    intern_free(&l->interner);
+    lit_table_free(&l->literals);
+}
+
+void
+lexer_reset(Lexer *l)
+{
+    l->index       = 0;
+    l->len         = 0;
+    l->file_length = l->file->length; // the file may have been read again
+    l->end         = l->file_length;
+    l->save_index = 0;
+    l->error      = LE_UNKNOWN;
+    l->prev       = Tkn_EOT;
+    tkn_stream_clear(&l->tokens);
+    intern_clear(&l->interner);
+    lit_table_clear(&l->literals);
+    l->dead_literals = 0;
 }
 
 void
 lexer_save_log(Lexer *l, FILE *output)
 {
-    array_for_each(l->tokens, el)
+    for (TknIdx i = 0; i < tkn_count(&l->tokens); i++)
     {
-        log_token(output, *el, l->file->contents);
+        log_token(output, tkn_at(&l->tokens, i), l->file->contents);
     }
 }
 
 u8
 lexer_lex(Lexer *l)
 {
-    for (;;)
+    if (lex_run(l) == FAILURE) return lex_report_error(l);
+
+    l->len = 0;
+    for (u8 i = 0; i < EXTRA_NULL_TERMINATORS; ++i)
+        lex_add_token(l, Tkn_EOT);
+    return SUCCESS;
+}
+
+/*
+ *
+ * Chunked parallel lexing
+ * NOTE(5717): the file is split after newlines, each chunk is lexed as if
+ * it started at the top level. When a string or a nested comment crosses a
+ * split the previous chunk ends past it, that chunk is relexed serially from
+ * where the previous one really stopped.
+ *
+ */
+typedef struct
+{
+    Lexer lexer;
+    uint start; // speculative start offset
+    u8 status;
+} LexChunk;
+
+// first non blank byte after the newline at or after `from`
+internal uint
+lex_chunk_boundary(File *file, uint from)
+{
+    cstr contents  = file->contents;
+    cstr newline   = memchr(contents + from, '\n', file->length - from);
+    if (!newline) return file->length;
+
+    uint index = (uint)(newline - contents);
+    while (index < file->length && (scan_is(contents[index], CC_SPACE) || contents[index] == '\n'))
+        index++;
+    return index;
+}
+
+internal void
+lex_chunk_reset(LexChunk *chunk, uint start)
+{
+    Lexer *l          = &chunk->lexer;
+    l->index          = start;
+    l->len            = 0;
+    l->save_index     = start;
+    l->error          = LE_UNKNOWN;
+    l->prev           = Tkn_EOT;
+    tkn_stream_clear(&l->tokens);
+    // names and literals from a discarded speculative run must not leak into the ids
+    if (intern_count(&l->interner) > 0) intern_clear(&l->interner);
+    lit_table_clear(&l->literals);
+}
+
+// chunk syms and literal ids are local to the chunk, move tokens [base..] to `l`'s
+internal void
+lex_chunk_remap_syms(Lexer *l, Lexer *c, usize base)
+{
+    const uint names = (uint)intern_count(&c->interner);
+    Sym *remap       = mem_alloc(sizeof(Sym) * (names + 1));
+    remap[SYM_NONE]  = SYM_NONE;
+    for (Sym sym = 1; sym <= names; sym++)
     {
-        const u8 status = lex_director(l);
-        switch (status)
+        const InternKey *key = intern_key(&c->interner, sym);
+        remap[sym]           = intern(&l->interner, key->str, key->length);
+    }
+
+    // literals keep their order, string bytes move past those already in `l`
+    const uint first_literal = (uint)array_count(l->literals.values);
+    const uint first_byte    = (uint)array_count(l->literals.bytes);
+    array_append(l->literals.values, c->literals.values->elements, array_count(c->literals.values));
+    array_append(l->literals.bytes, c->literals.bytes->elements, array_count(c->literals.bytes));
+
+    const u8 *kinds  = l->tokens.kinds->elements;
+    Sym *syms        = l->tokens.syms->elements;
+    LitValue *values = l->literals.values->elements;
+    for (usize t = base; t < tkn_count(&l->tokens); t++)
+    {
+        if (!is_token_a_literal(kinds[t])) {
+            syms[t] = remap[syms[t]];
+            continue;
+        }
+        syms[t] += first_literal;
+        if (kinds[t] == Tkn_StringLiteral) values[syms[t] - 1].s.offset += first_byte;
+    }
+    mem_free(remap);
+}
+
+internal void
+lex_chunk_task(void *ctx, uint index)
+{
+    LexChunk *chunk = (LexChunk *)ctx + index;
+    chunk->status   = lex_run(&chunk->lexer);
+}
+
+u8
+lexer_lex_parallel(Lexer *l, uint jobs)
+{
+    File *file = l->file;
+    if (jobs < 2 || file->length < LEX_PARALLEL_MIN_LENGTH) return lexer_lex(l);
+
+    uint count = file->length / LEX_CHUNK_MIN_LENGTH;
+    if (count > jobs) count = jobs;
+
+    LexChunk *chunks = mem_alloc(sizeof(LexChunk) * count);
+    uint start       = 0;
+    uint n           = 0;
+    for (uint i = 0; i < count && start < file->length; i++)
+    {
+        const uint target = (uint)((u64)file->length * (i + 1) / count);
+        const uint end     = i + 1 == count ? file->length : lex_chunk_boundary(file, target);
+        if (end <= start) continue;
+
+        LexChunk *chunk     = &chunks[n++];
+        chunk->lexer        = *l;
+        chunk->lexer.end    = end;
+        chunk->lexer.tokens   = tkn_stream_make(TOKENS_GUESS(end - start));
+        chunk->lexer.interner = intern_make(NAMES_GUESS(end - start));
+        chunk->lexer.literals = lit_table_make(LITERALS_GUESS(end - start));
+        chunk->start        = start;
+        lex_chunk_reset(chunk, start);
+        start = end;
+    }
+
+    pool_run(jobs, n, lex_chunk_task, chunks);
+
+    // stitch in order, `l` carries the real state across chunk borders
+    u8 status     = SUCCESS;
+    uint expected = 0;
+    for (uint i = 0; i < n; i++)
+    {
+        LexChunk *chunk = &chunks[i];
+        Lexer *c        = &chunk->lexer;
+        if (chunk->start != expected)
         {
-            case SUCCESS: break;
-            case DONE: {
-                l->len = 0;
-                for (u8 i = 0; i < EXTRA_NULL_TERMINATORS; ++i)
-                    lex_add_token(l, Tkn_EOT);
-                return SUCCESS;
+            // the previous chunk ran past our split, redo it from where it stopped
+            if (expected >= c->end) continue;
+            lex_chunk_reset(chunk, expected);
+            chunk->start  = expected;
+            chunk->status = lex_run(c);
+        }
+
+        if (chunk->status == FAILURE)
+        {
+            status = lex_report_error(c);
+            break;
+        }
+
+        // a leading terminator is only kept when the real state had none pending
+        const usize lexed = tkn_count(&c->tokens);
+        usize first       = 0;
+        if (lexed > 0 && tkn_kind(&c->tokens, 0) == Tkn_Terminator && l->prev == Tkn_Terminator)
+            first = 1;
+
+        const usize base = tkn_count(&l->tokens);
+        tkn_stream_append(&l->tokens, &c->tokens, first);
+        lex_chunk_remap_syms(l, c, base);
+        if (lexed > 0) l->prev = c->prev;
+
+        expected = c->index;
+        // a NUL byte inside the chunk ends lexing just like in lexer_lex
+        if (c->index < c->end) break;
+    }
+
+    l->index = expected;
+    for (uint i = 0; i < n; i++)
+        lexer_deinit(&chunks[i].lexer);
+    mem_free(chunks);
+
+    if (status == FAILURE) return FAILURE;
+
+    l->len = 0;
+    for (u8 i = 0; i < EXTRA_NULL_TERMINATORS; ++i)
+        lex_add_token(l, Tkn_EOT);
+    return SUCCESS;
+}
+
+/*
+ *
+ * Incremental relexing
+ * NOTE(5717): lexing restarts where the lexer stood after a token two tokens
+ * before the edit (start + length, `@x` and `..` start past their first
+ * char), that is never inside a comment or a string and the spare token
+ * covers the lookahead of numbers and comments. New tokens are lexed
+ * until one past the edit has the kind, length and (shifted) start of an old
+ * token: the lexer state after both is the same (every token leaves `prev`
+ * at Tkn_Terminator, see lex_add_token) so every later old token still
+ * holds. The new run replaces the old tokens in between and the starts of
+ * the tail move by the size change of the edit.
+ *
+ */
+LexEdit
+lexer_edit_between(cstr before, uint before_length, cstr after, uint after_length)
+{
+    const uint shortest = before_length < after_length ? before_length : after_length;
+    uint prefix         = 0;
+    while (prefix < shortest && before[prefix] == after[prefix]) prefix++;
+    uint suffix = 0;
+    while (suffix < shortest - prefix && before[before_length - 1 - suffix] == after[after_length - 1 - suffix])
+        suffix++;
+    return (LexEdit){prefix, before_length - prefix - suffix, after_length - prefix - suffix};
+}
+
+// number of tokens ending before `offset`, token ends never decrease
+internal TknIdx
+lex_tokens_before(const TokenStream *s, usize count, uint offset)
+{
+    usize lo = 0, hi = count;
+    while (lo < hi)
+    {
+        const usize mid = lo + (hi - lo) / 2;
+        if (tkn_start(s, mid) + tkn_length(s, mid) < offset) lo = mid + 1;
+        else hi = mid;
+    }
+    return (TknIdx)lo;
+}
+
+// first token of [from, count) starting at or after `offset`
+internal TknIdx
+lex_token_at(const TokenStream *s, usize from, usize count, uint offset)
+{
+    usize lo = from, hi = count;
+    while (lo < hi)
+    {
+        const usize mid = lo + (hi - lo) / 2;
+        if (tkn_start(s, mid) < offset) lo = mid + 1;
+        else hi = mid;
+    }
+    return (TknIdx)lo;
+}
+
+u8
+lexer_relex(Lexer *l, LexEdit edit, TknEdit *changed)
+{
+    TokenStream *old = &l->tokens;
+    const i64 shift  = (i64)edit.inserted - (i64)edit.removed;
+
+    // the EOT padding is kept with the tail, or added again when lexing runs to the end
+    usize count = tkn_count(old);
+    while (count > 0 && tkn_kind(old, count - 1) == Tkn_EOT) count--;
+
+    const TknIdx before  = lex_tokens_before(old, count, edit.offset);
+    const TknIdx restart = before > 2 ? before - 2 : 0;
+
+    Lexer run       = *l;
+    run.file_length = l->file->length;
+    run.end         = run.file_length;
+    run.index       = restart ? tkn_start(old, restart - 1) + tkn_length(old, restart - 1) : 0;
+    run.save_index  = run.index;
+    run.len         = 0;
+    run.error       = LE_UNKNOWN;
+    run.prev        = restart ? Tkn_Terminator : Tkn_EOT;
+    run.tokens      = tkn_stream_make(64);
+
+    const uint edit_end = edit.offset + edit.inserted; // in the new text
+    usize checked       = 0;
+    usize kept          = 0;                // new tokens before the resync
+    TknIdx resync       = (TknIdx)tkn_count(old); // first old token kept, none but the padding
+    bool synced         = false;
+    u8 status           = SUCCESS;
+    while (!synced)
+    {
+        status = lex_director(&run);
+        if (status != SUCCESS) break;
+
+        for (; checked < tkn_count(&run.tokens); checked++)
+        {
+            const uint start = tkn_start(&run.tokens, checked);
+            if (start < edit_end) continue;
+
+            const uint old_start = (uint)((i64)start - shift);
+            const TknIdx at      = lex_token_at(old, restart, count, old_start);
+            if (at < count && tkn_start(old, at) == old_start && tkn_kind(old, at) == tkn_kind(&run.tokens, checked) &&
+                tkn_length(old, at) == tkn_length(&run.tokens, checked)) {
+                kept   = checked;
+                resync = at;
+                synced = true;
+                break;
             }
-            case FAILURE: return lex_report_error(l);
         }
     }
-    return FAILURE;
+    l->interner = run.interner; // may have grown, syms of both runs come from it
+    l->literals = run.literals; // the same, values of replaced tokens stay unused until the next reset
+
+    if (status == FAILURE) {
+        lex_report_error(&run);
+        tkn_stream_free(&run.tokens);
+        tkn_stream_clear(old); // matches neither text, the next lex starts over
+        return FAILURE;
+    }
+    if (!synced) kept = tkn_count(&run.tokens);
+
+    // the literals of the replaced tokens and of the new ones past the resync stay in the table
+    for (TknIdx t = restart; t < resync; t++) l->dead_literals += is_token_a_literal(tkn_kind(old, t));
+    for (usize t = kept; t < tkn_count(&run.tokens); t++)
+        l->dead_literals += is_token_a_literal(tkn_kind(&run.tokens, t));
+
+    tkn_stream_splice(old, restart, resync, &run.tokens, kept, shift);
+    tkn_stream_free(&run.tokens);
+    *changed = (TknEdit){restart, resync - restart, (uint)kept + (synced ? 0 : EXTRA_NULL_TERMINATORS)};
+
+    l->file_length = run.file_length;
+    l->end         = run.end;
+    l->index       = synced ? l->file_length : run.index;
+    l->error       = LE_UNKNOWN;
+    if (!synced) {
+        l->len = 0;
+        for (u8 i = 0; i < EXTRA_NULL_TERMINATORS; ++i)
+            lex_add_token(l, Tkn_EOT);
+    }
+    l->prev = Tkn_Terminator;
+    return SUCCESS;
 }
 
-Array(Token) lexer_get_tokens(Lexer *l)
+TokenStream *
+lexer_get_tokens(Lexer *l)
 {
-    return l->tokens;
+    return &l->tokens;
 }
 
 // PRIVATE internals
 
+// lexes until l->end, a NUL byte or an error, without the EOT tokens
+u8
+lex_run(Lexer *l)
+{
+    for (;;)
+    {
+        const u8 status = lex_director(l);
+        if (status != SUCCESS) return status == DONE ? SUCCESS : FAILURE;
+    }
+}
+
 inline void
 lex_skip_whitespace(Lexer *l)
 {
     for (;;)
     {
-        const char c = lex_current(l);
-        if (c == ' ' || c == '\t' || c == '\r')
-        {
-            l->index += 1;
-        }
-        else if (c == '\n')
-        {
-            lex_add_terminator(l);
-            l->line += 1;
-        }
-        else
-        {
-            break;
-        }
+        l->index += scan_whitespace(lex_ptr(l));
+        if (lex_current(l) != '\n') break;
+
+        // zero length terminator at the newline, then count the line once
+        if (l->prev != Tkn_Terminator) lex_add_token(l, Tkn_Terminator);
+        lex_advance(l);
     }
 }
 
 u8
 lex_director(Lexer *l)
 {
-    l->len = 0, l->begin_tkn_line = l->line;
+    l->len = 0;
     lex_skip_whitespace(l);
+    if (l->index >= l->end) return DONE;
     lex_save_state(l);
     const char c = lex_current(l);
     // ints and floats
-    if (isdigit(c)) return lex_numbers(l);
+    if (scan_is(c, CC_DIGIT)) return lex_numbers(l);
     // chars, and strings
     // TODO: Multiline strings
     if (c == '"') return lex_strings(l);
     if (c == '\'') return lex_chars(l);
 
     // NOTE: Idenitifiers, keywords and builtin functions
-    if (c == '_' || isalpha(c)) return lex_identifiers(l);
+    if (c == '_' || scan_is(c, CC_ALPHA)) return lex_identifiers(l);
     if (c == '@') return lex_builtin_funcs(l);
     //  Symbols
     return lex_symbols(l);
@@ -146,136 +527,9 @@ lex_director(Lexer *l)
 u8
 lex_identifiers(Lexer *l)
 {
-    lex_advance_len_inc(l);
-    while (isalnum(lex_current(l)) || lex_current(l) == '_')
-    {
-        lex_advance_len_inc(l);
-    }
-    l->index -= l->len;
-    TknType _type = Tkn_Identifier;
-
-    // TODO: optimize searching for matching keywords
-    switch (l->len)
-    {
-        case 2: {
-            switch (lex_current(l))
-            {
-                case 'a':
-                    if (lex_keyword_match(l, "as", 2)) _type = Tkn_AsKeyword;
-                    break;
-                case 'f':
-                    if (lex_keyword_match(l, "fn", 2)) _type = Tkn_FnKeyword;
-                    break;
-                case 'i':
-                    if (lex_keyword_match(l, "if", 2)) _type = Tkn_IfKeyword;
-                    if (lex_keyword_match(l, "in", 2)) _type = Tkn_InKeyword;
-                    break;
-                case 'o':
-                    if (lex_keyword_match(l, "or", 2)) _type = Tkn_OrKeyword;
-                    break;
-                default: break;
-            }
-
-            break;
-        }
-        case 3: {
-            switch (lex_current(l))
-            {
-                case 'l':
-                    if (lex_keyword_match(l, "let", 3)) _type = Tkn_LetKeyword;
-                    break;
-                case 'f':
-                    if (lex_keyword_match(l, "for", 3)) _type = Tkn_ForKeyword;
-                    break;
-                case 'p':
-                    if (lex_keyword_match(l, "pub", 3)) _type = Tkn_PubKeyword;
-                    break;
-                case 'i':
-                    if (lex_keyword_match(l, "int", 3)) _type = Tkn_IntKeyword;
-                    break;
-                case 'r':
-                    if (lex_keyword_match(l, "ref", 3))
-                        _type = Tkn_RefKeyword;
-                    else if (lex_keyword_match(l, "ret", 3))
-                        _type = Tkn_RetKeyword;
-                    break;
-                case 'a':
-                    if (lex_keyword_match(l, "and", 3)) _type = Tkn_AndKeyword;
-                    break;
-                case 'n':
-                    if (lex_keyword_match(l, "nil", 3)) _type = Tkn_NilLiteral;
-                    break;
-            }
-            break;
-        }
-        case 4: {
-            switch (lex_current(l))
-            {
-                case 'e': {
-                    if (lex_keyword_match(l, "else", 4))
-                        _type = Tkn_ElseKeyword;
-                    else if (lex_keyword_match(l, "enum", 4))
-                        _type = Tkn_EnumKeyword;
-                    break;
-                }
-                case 't':
-                    if (lex_keyword_match(l, "true", 4)) _type = Tkn_TrueLiteral;
-                    break;
-                case 'c':
-                    if (lex_keyword_match(l, "char", 4)) _type = Tkn_CharKeyword;
-                    break;
-                case 'b':
-                    if (lex_keyword_match(l, "bool", 4)) _type = Tkn_BoolKeyword;
-                    break;
-                case 'u':
-                    if (lex_keyword_match(l, "uint", 4)) _type = Tkn_UIntKeyword;
-                    break;
-                case 'f':
-                    if (lex_keyword_match(l, "fall", 4)) _type = Tkn_FallKeyword;
-                    break;
-            }
-            break;
-        }
-        case 5: {
-            switch (lex_current(l))
-            {
-                case 'w':
-                    if (lex_keyword_match(l, "while", 5)) _type = Tkn_WhileKeyword;
-                    break;
-                case 'f': {
-                    if (lex_keyword_match(l, "false", 5))
-                        _type = Tkn_FalseLiteral;
-                    else if (lex_keyword_match(l, "float", 5))
-                        _type = Tkn_FltKeyword;
-                    break;
-                }
-                case 'b':
-                    if (lex_keyword_match(l, "break", 5)) _type = Tkn_BreakKeyword;
-                    break;
-            }
-            break;
-        }
-        case 6: {
-            switch (lex_current(l))
-            {
-                case 'i':
-                    if (lex_keyword_match(l, "import", 6)) _type = Tkn_ImportKeyword;
-                    break;
-                case 'd':
-                    if (lex_keyword_match(l, "delete", 6)) _type = Tkn_DeleteKeyword;
-                    break;
-                case 's': {
-                    if (lex_keyword_match(l, "struct", 6))
-                        _type = Tkn_StructKeyword;
-                    else if (lex_keyword_match(l, "switch", 6))
-                        _type = Tkn_SwitchKeyword;
-                    break;
-                }
-            }
-            break;
-        }
-        default: break;
-    }
+    // identifiers never span lines, so the whole run is taken at once
+    l->len = scan_identifier(lex_ptr(l));
+    const TknType _type = lex_keyword(l);
 
     if (l->len > MAX_IDENTIFIER_LENGTH)
     {
@@ -307,25 +561,26 @@ lex_numbers(Lexer *l)
     }
 
     bool reached_dot = false;
-    while (isdigit(lex_current(l)))
-    {
-        lex_advance_len_inc(l);
-    }
-    
+    const uint digits = scan_digits(lex_ptr(l));
+    l->index += digits;
+    l->len += digits;
+
+
     // Check for decimal point, but only if it's not part of a range operator
     if (lex_current(l) == '.' && lex_peek(l) != '.') {
         reached_dot = true;
         lex_advance_len_inc(l);
         
         // Continue reading digits after decimal point
-        while (isdigit(lex_current(l))) {
-            lex_advance_len_inc(l);
-        }
+        const uint fraction = scan_digits(lex_ptr(l));
+        l->index += fraction;
+        l->len += fraction;
     }
 
     if (l->len > MAX_NUMBER_LENGTH)
     {
         log_error("number digits length is above 100");
+        l->error = LE_TOO_LONG_NUMBER;
         lex_restore_state_for_err(l);
         return FAILURE;
     }
@@ -339,7 +594,7 @@ lex_hex_numbers(Lexer *l)
     // skip '0x'
     lex_advance_len_inc(l);
     lex_advance_len_inc(l);
-    while (isxdigit(lex_current(l)))
+    while (scan_is(lex_current(l), CC_XDIGIT))
     {
         lex_advance_len_inc(l);
     }
@@ -347,6 +602,7 @@ lex_hex_numbers(Lexer *l)
     if (l->len > 0x20)
     {
         log_error("hex number digits length is above 32");
+        l->error = LE_TOO_LONG_NUMBER;
         lex_restore_state_for_err(l);
         return FAILURE;
     }
@@ -368,6 +624,7 @@ lex_binary_numbers(Lexer *l)
     if (l->len > 0x80)
     {
         log_error("binary number digits length is above 128");
+        l->error = LE_TOO_LONG_NUMBER;
         lex_restore_state_for_err(l);
         return FAILURE;
     }
@@ -493,6 +750,9 @@ lex_chars(Lexer *l)
         }
     }
 
+    // a lone quote or more than one char before the closing one
+    l->error = LE_NOT_CLOSED_CHAR;
+    lex_restore_state_for_err(l);
     return FAILURE;
 }
 
@@ -591,9 +851,8 @@ lex_symbols(Lexer *l)
             }
             else if (p == '/')
             {
-                //
-                while (lex_is_not_eof(l) && lex_current(l) != '\n')
-                    lex_advance(l);
+                // the body has no newlines, skip it in one step
+                l->index += scan_line(lex_ptr(l));
                 return SUCCESS;
             }
             else if (p == '*')
@@ -612,8 +871,7 @@ lex_symbols(Lexer *l)
         }
         case '#': {
             // this is for comments
-            while (lex_current(l) != '\n' && lex_is_not_eof(l))
-                lex_advance(l);
+            l->index += scan_line(lex_ptr(l));
             lex_advance(l);
             return SUCCESS;
         }
@@ -636,7 +894,7 @@ lex_builtin_funcs(Lexer *l)
     lex_advance(l); // skip '@'
 
     // NOTE(5717): ONLY ALPHABET CHARS ARE ALLOWED
-    while (isalpha(lex_current(l)))
+    while (scan_is(lex_current(l), CC_ALPHA))
     {
         lex_advance_len_inc(l);
     }
@@ -648,9 +906,7 @@ lex_builtin_funcs(Lexer *l)
 inline void
 lex_advance(Lexer *l)
 {
-    const char c = lex_current(l);
     l->index += 1;
-    l->line += (c == '\n');
 }
 
 inline void
@@ -662,10 +918,8 @@ lex_advance_len_times(Lexer *l)
 inline void
 lex_advance_len_inc(Lexer *l)
 {
-    const char c = lex_current(l);
     l->index += 1;
     l->len += 1;
-    l->line += (c == '\n');
 }
 
 inline char
@@ -680,6 +934,12 @@ lex_current(Lexer *l)
     return l->file->contents[l->index];
 }
 
+inline cstr
+lex_ptr(Lexer *l)
+{
+    return l->file->contents + l->index;
+}
+
 inline char
 lex_past(Lexer *l)
 {
@@ -692,55 +952,54 @@ lex_is_not_eof(Lexer *l)
     return l->index < l->file_length;
 }
 
-inline bool
-lex_keyword_match(Lexer *l, cstr cstr, uint length)
+// l->index is at the start of an identifier of l->len chars
+inline TknType
+lex_keyword(Lexer *l)
 {
-    bool res = (strncmp(l->file->contents + l->index, cstr, length) == 0);
-    return res;
+    const uint len = l->len;
+    if (len < KW_MIN_LENGTH || len > KW_MAX_LENGTH) return Tkn_Identifier;
+
+    // the file tail padding makes the 8 byte load safe near EOF
+    cstr str           = lex_ptr(l);
+    const Keyword *kw  = &keyword_table[KW_HASH(str[0], str[len - 1], len)];
+    u64 word, key, mask;
+    memcpy(&word, str, sizeof(word));
+    memcpy(&key, kw->text, sizeof(key));
+    memcpy(&mask, keyword_masks[len], sizeof(mask));
+
+    // identifier chars are never NUL, so a shorter spelling can not match
+    return (word & mask) == key ? kw->type : Tkn_Identifier;
 }
 
 inline void
 lex_save_state(Lexer *l)
 {
     l->save_index = l->index;
-    l->save_line  = l->line;
 }
 
 inline void
 lex_restore_state_for_err(Lexer *l)
 {
     l->index = l->save_index;
-    l->line  = l->save_line;
 }
 
 u8
 lex_report_error(Lexer *l)
 {
-    uint low = l->index, col = 0;
-    const uint line = l->line;
-    const uint len = l->len;
-    const uint index = l->index;
-    File *file = l->file;
-
-    while (file->contents[low] != '\n' && low > 0) {
-        low--;
-        col++;
-    }
-    low = low > 1 ? low + 1 : 0;
-
-    uint _length = l->index;
-    while (file->contents[_length] != '\n' && _length + 1 < file->length)
-        _length++;
-
-    _length -= low;
-
-    fprintf(stderr, " > %s%s%s:%u:%u: %serror: %s%s%s\n", BOLD, WHITE, file->name, line, col, LRED,
+    const uint len    = l->len;
+    File *file        = l->file;
+    const FilePos pos = file_pos(file, l->index);
+    const uint line   = pos.line;
+    uint _length      = 0;
+    cstr text         = file_line_text(file, line, &_length);
+
+    fprintf(log_output(), " > %s%s%s:%u:%u: %serror: %s%s%s\n", BOLD, WHITE, file->name, line, pos.col, LRED,
             LBLUE, lexer_err_msg(l->error), RESET);
 
-    fprintf(stderr, "  %s%u%s | %.*s\n", LYELLOW, line, RESET, _length, (file->contents + low));
+    fprintf(log_output(), "  %s%u%s | %.*s\n", LYELLOW, line, RESET, _length, text);
 
     const uint num_line_digits = get_digits_from_number(line);
-    const uint spaces = index - low + 1;
+    const uint spaces = pos.col + 1; // one more for the space after `|`
 
     const uint MAX_ARROW_LEN = 101;
     if (len < 101) {
@@ -749,21 +1008,119 @@ lex_report_error(Lexer *l)
         memset(arrows, '^', len);
         arrows[len] = '\0';
 
-        fprintf(stderr, "  %*c |%*c%s%s%s\n", num_line_digits, ' ', spaces - 1, ' ', LRED, BOLD, arrows);
+        fprintf(log_output(), "  %*c |%*c%s%s%s\n", num_line_digits, ' ', spaces - 1, ' ', LRED, BOLD, arrows);
     } else {
-        fprintf(stderr, "  %*c |%*c%s%s^^^---...\n", num_line_digits, ' ', spaces - 1, ' ', LRED, BOLD);
+        fprintf(log_output(), "  %*c |%*c%s%s^^^---...\n", num_line_digits, ' ', spaces - 1, ' ', LRED, BOLD);
     }
 
-    fprintf(stderr, " > Advice: %s%s\n", RESET, lexer_err_advice(l->error));
+    fprintf(log_output(), " > Advice: %s%s\n", RESET, lexer_err_advice(l->error));
     return FAILURE;
 }
 
+/*
+ *
+ * Literal decoding
+ * NOTE(5717): runs from lex_add_token on tokens the lex_* functions already
+ * checked, so the text is well formed: digits of the radix, quotes around
+ * chars and strings and only the escapes lex_chars lets through in chars.
+ *
+ */
+#define LIT_U128_MAX (~(__uint128_t)0)
+
+// byte an escape stands for, `\\`, `\'` and `\"` stand for the char after the backslash
+internal char
+lex_unescape(char c)
+{
+    switch (c)
+    {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        default: return c;
+    }
+}
+
+internal LitValue
+lex_decode_integer(cstr text, uint length)
+{
+    uint bits = 0; // per digit of 0x and 0b literals, 0 for decimals
+    uint at   = 0;
+    if (length >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'b')) {
+        bits = text[1] == 'x' ? 4 : 1;
+        at   = 2;
+    }
+
+    __uint128_t value = 0;
+    for (; at < length; at++)
+    {
+        const char c     = text[at];
+        const uint digit = c <= '9' ? (uint)(c - '0') : (uint)((c | 0x20) - 'a' + 10);
+        if (bits) {
+            value = value << bits | digit; // the lexer caps these below 128 bits
+            continue;
+        }
+        if (value > LIT_U128_MAX / 10 || (value == LIT_U128_MAX / 10 && digit > LIT_U128_MAX % 10)) {
+            value = LIT_U128_MAX;
+            break;
+        }
+        value = value * 10 + digit;
+    }
+    return (LitValue){.i = {(u64)value, (u64)(value >> 64)}};
+}
+
+// unescapes the string between the quotes into the literal bytes
+internal LitValue
+lex_decode_string(LitTable *t, cstr text, uint length)
+{
+    const uint offset = (uint)array_count(t->bytes);
+    cstr end          = text + length;
+    while (text < end)
+    {
+        cstr escape = memchr(text, '\\', (usize)(end - text));
+        if (!escape) escape = end;
+        array_append(t->bytes, (const u8 *)text, (usize)(escape - text));
+        if (escape + 1 >= end) break; // a backslash right before the closing quote
+        const u8 byte = (u8)lex_unescape(escape[1]);
+        array_push(t->bytes, byte);
+        text = escape + 2;
+    }
+    const uint count = (uint)array_count(t->bytes) - offset;
+    array_push(t->bytes, (u8)'\0');
+    return (LitValue){.s = {offset, count}};
+}
+
+// decodes the token the lexer stands on into l->literals, returns its id
+internal uint
+lex_literal(Lexer *l, TknType type)
+{
+    cstr text         = lex_ptr(l);
+    const uint length = l->len;
+    LitValue value    = {0};
+    switch (type)
+    {
+        case Tkn_IntegerLiteral: value = lex_decode_integer(text, length); break;
+        case Tkn_FloatLiteral: {
+            // strtod would read on into an exponent the lexer left for the next token
+            char buffer[MAX_NUMBER_LENGTH + 1];
+            memcpy(buffer, text, length);
+            buffer[length] = '\0';
+            value.f        = strtod(buffer, nullptr);
+        } break;
+        case Tkn_CharLiteral: value.i.lo = (u8)(text[1] == '\\' ? lex_unescape(text[2]) : text[1]); break;
+        default: value = lex_decode_string(&l->literals, text + 1, length - 2); break;
+    }
+    array_push(l->literals.values, value);
+    return (uint)array_count(l->literals.values);
+}
+
 inline u8
 lex_add_token(Lexer *l, TknType type)
 {
     // index at the end of the token
-    Token tkn = (Token){l->index, l->len, l->begin_tkn_line, type};
-    array_push(l->tokens, tkn);
+    Sym sym = SYM_NONE;
+    if (type == Tkn_Identifier || type == Tkn_BuiltinId) sym = intern(&l->interner, lex_ptr(l), l->len);
+    else if (is_token_a_literal(type)) sym = lex_literal(l, type);
+    tkn_stream_push(&l->tokens, (Token){l->index, l->len, type, sym});
     l->prev = Tkn_Terminator;
     lex_advance_len_times(l);
     return SUCCESS;
@@ -807,6 +1164,7 @@ u8 lex_nested_comments(Lexer *l) {
 // Adjusted log_debug call to format the string before passing it
 void log_lexer_state(Lexer *l) {
     char buffer[128];
-    snprintf(buffer, sizeof(buffer), "Lexer state: index=%u, line=%u", l->index, l->line);
+    snprintf(buffer, sizeof(buffer), "Lexer state: index=%u, line=%u", l->index,
+             file_pos(l->file, l->index).line);
     log_debug(buffer);
 }
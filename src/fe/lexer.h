@@ -2,23 +2,43 @@
 
 #include "token.h"
 
-generate_array_type(Token);
-
 typedef struct Lexer
 {
     // lexer state variables
-    uint index, len, line, begin_tkn_line, file_length;
+    uint index, len, file_length;
+    uint end; // lexing stops here, file_length unless lexing a chunk
     File *file; // not owned by the lexer
     LexErr error;
-    uint save_index, save_line;
+    uint save_index;
     TknType prev;
-    Array(Token) tokens;
+    TokenStream tokens;
+    Interner interner; // spellings of names, one per compilation
+    LitTable literals; // values of number, char and string tokens
+    uint dead_literals; // entries of tokens a relex replaced, reclaimed by the next full lex
 } Lexer;
 
 // Lexer API
 Lexer lexer_init(File *);
 void lexer_deinit(Lexer *);
-Array(Token) lexer_get_tokens(Lexer *lexer);
+void lexer_reset(Lexer *); // ready to lex its file again (maybe reread), keeps the buffers
+TokenStream *lexer_get_tokens(Lexer *lexer);
 u8 lexer_lex(Lexer *);
+// splits big files across `jobs` threads, same result as lexer_lex
+u8 lexer_lex_parallel(Lexer *, uint jobs);
 void lexer_save_log(Lexer *, FILE *);
+
+// one edit of the file text, see lexer_relex
+typedef struct
+{
+    uint offset;   // first byte it touches
+    uint removed;  // bytes of the old text it replaces
+    uint inserted; // bytes of the new text in their place
+} LexEdit;
+
+// the single edit turning `before` into `after`, their common prefix and suffix are kept
+LexEdit lexer_edit_between(cstr before, uint before_length, cstr after, uint after_length);
+// relexes around `edit` once l->file holds the text after it, l->tokens must be
+// the tokens of the text before it. On FAILURE the error is reported and the
+// tokens are cleared. The tokens it replaced go to `changed`
+u8 lexer_relex(Lexer *, LexEdit edit, TknEdit *changed);
 // internal methods are in lexer.c
@@ -0,0 +1,407 @@
+#include "module.h"
+#include "../include/pool.h"
+
+#include <sys/stat.h>
+
+#define MODULE_EXT ".vr"
+#define MODULE_GUESS 64u
+
+ModuleGraph
+module_graph_make(char **roots, uint root_count)
+{
+    return (ModuleGraph){
+        .paths      = intern_make(MODULE_GUESS),
+        .modules    = array_make(ModulePtr, MODULE_GUESS),
+        .order      = array_make(uint, MODULE_GUESS),
+        .levels     = 0,
+        .roots      = roots,
+        .root_count = root_count,
+        .st         = ST_UNKNOWN,
+    };
+}
+
+void
+module_graph_free(ModuleGraph *g)
+{
+    for (usize i = 0; i < module_count(g); i++)
+    {
+        Module *m = module_at(g, i);
+        if (m->checker.parser) checker_deinit(&m->checker);
+        if (m->parser.lexer) parser_deinit(&m->parser);
+        if (m->lexer.file) lexer_deinit(&m->lexer);
+        if (m->file.valid_code == success) file_free(&m->file);
+        cache_entry_free(&m->cache);
+        array_free(m->imports);
+        array_free(m->import_offsets);
+        mem_free(m);
+    }
+    array_free(g->modules);
+    array_free(g->order);
+    intern_free(&g->paths);
+    *g = (ModuleGraph){0};
+}
+
+// canonical spelling of an existing file, false when there is none
+internal bool
+module_canonical(cstr path, char canonical[PATH_MAX])
+{
+#if OS_WIN
+    struct stat st;
+    return _fullpath(canonical, path, PATH_MAX) && stat(canonical, &st) == 0 && !(st.st_mode & S_IFDIR);
+#else
+    struct stat st;
+    return realpath(path, canonical) && stat(canonical, &st) == 0 && !S_ISDIR(st.st_mode);
+#endif
+}
+
+// module for a canonical path, created on first sight
+internal ModuleIdx
+module_add(ModuleGraph *g, cstr path)
+{
+    const Sym sym = intern(&g->paths, path, (uint)strlen(path));
+    if (sym <= module_count(g)) return sym - 1;
+
+    Module *m = mem_alloc(sizeof(Module));
+    memset(m, 0, sizeof(Module));
+    m->path           = intern_str(&g->paths, sym);
+    m->imports        = array_make(uint, 4);
+    m->import_offsets = array_make(uint, 4);
+    m->st             = ST_UNKNOWN;
+    m->status         = SUCCESS;
+    array_push(g->modules, m);
+    return sym - 1;
+}
+
+/*
+ *
+ * Loading
+ *
+ */
+typedef struct
+{
+    ModuleGraph *g;
+    uint first;    // first module of the wave
+    uint file_jobs; // lexer, parser and checker threads per module
+} ModuleWave;
+
+internal u8
+module_read(Module *m, uint file_jobs, cstr cache_dir)
+{
+    m->st                = ST_FILE;
+    TimeStamp start      = time_now();
+    const File temp_file = file_read(m->path);
+    memcpy(&m->file, &temp_file, sizeof(File));
+    m->stages[ST_FILE] = time_since(start);
+    if (m->file.valid_code != success) return FAILURE;
+
+    if (cache_dir) {
+        m->st = ST_CACHE;
+        start = time_now();
+        const bool hit = cache_load(cache_dir, &m->file, &m->cache);
+        m->stages[ST_CACHE] = time_since(start);
+        if (hit) return SUCCESS;
+    }
+
+    m->st   = ST_LEXER;
+    start   = time_now();
+    m->lexer = lexer_init(&m->file);
+    u8 status = lexer_lex_parallel(&m->lexer, file_jobs);
+    m->stages[ST_LEXER] = time_since(start);
+    if (status == FAILURE) return FAILURE;
+
+    m->st     = ST_PARSER;
+    start     = time_now();
+    m->parser = parser_init(&m->lexer);
+    status    = parser_parse_parallel(&m->parser, file_jobs);
+    m->stages[ST_PARSER] = time_since(start);
+    if (status == FAILURE) return parser_report_error(&m->parser);
+
+    // imports are not looked into, a module checks on its own
+    m->st      = ST_TCHECKER;
+    start      = time_now();
+    m->checker = checker_init(&m->parser);
+    status     = checker_check(&m->checker, file_jobs);
+    m->stages[ST_TCHECKER] = time_since(start);
+    if (status == FAILURE) return FAILURE;
+
+    if (cache_dir) {
+        start = time_now();
+        cache_store(cache_dir, &m->file, &m->lexer, &m->parser);
+        const TimeSpan spent = time_since(start);
+        m->stages[ST_CACHE].wall += spent.wall;
+        m->stages[ST_CACHE].cpu += spent.cpu;
+    }
+    return SUCCESS;
+}
+
+internal void
+module_load_task(void *ctx, uint index)
+{
+    ModuleWave *wave = ctx;
+    Module *m        = module_at(wave->g, wave->first + index);
+
+    log_capture_begin(&m->diag);
+    time_thread_cpu(wave->file_jobs == 1);
+    m->status = module_read(m, wave->file_jobs, wave->g->cache_dir);
+    time_thread_cpu(false);
+    log_capture_end(&m->diag);
+}
+
+internal void
+module_report_error(Module *m, uint offset, cstr message, cstr what, uint what_length, cstr advice)
+{
+    FILE *out         = log_output();
+    const FilePos pos = file_pos(&m->file, offset);
+    fprintf(out, " > %s%s%s:%u:%u: %serror: %s%s `%.*s`%s\n", BOLD, WHITE, m->path, pos.line, pos.col, LRED, LBLUE,
+            message, what_length, what, RESET);
+
+    uint _length = 0;
+    cstr text    = file_line_text(&m->file, pos.line, &_length);
+    if (_length > 0) {
+        const uint num_line_digits = get_digits_from_number(pos.line);
+        fprintf(out, "  %s%u%s | %.*s\n", LYELLOW, pos.line, RESET, _length, text);
+        fprintf(out, "  %*c |%*c%s^%s\n", num_line_digits, ' ', pos.col, ' ', LRED, RESET);
+    }
+    fprintf(out, " > Advice: %s%s\n", RESET, advice);
+}
+
+bool
+module_lookup(cstr importer, cstr spelling, uint length, char **roots, uint root_count, char canonical[PATH_MAX])
+{
+    const usize ext_len = strlen(MODULE_EXT);
+    cstr ext = length >= ext_len && !memcmp(spelling + length - ext_len, MODULE_EXT, ext_len) ? "" : MODULE_EXT;
+    char path[PATH_MAX];
+
+    if (spelling[0] == '/') {
+        snprintf(path, sizeof(path), "%.*s%s", length, spelling, ext);
+        return module_canonical(path, canonical);
+    }
+
+    cstr slash    = strrchr(importer, '/');
+    const int dir = slash ? (int)(slash - importer) : 0;
+    if (slash) snprintf(path, sizeof(path), "%.*s/%.*s%s", dir, importer, length, spelling, ext);
+    else snprintf(path, sizeof(path), "%.*s%s", length, spelling, ext);
+    if (module_canonical(path, canonical)) return true;
+
+    for (uint i = 0; i < root_count; i++)
+    {
+        snprintf(path, sizeof(path), "%s/%.*s%s", roots[i], length, spelling, ext);
+        if (module_canonical(path, canonical)) return true;
+    }
+    return false;
+}
+
+// records one import path token, a new module joins the next wave
+internal u8
+module_resolve_import(ModuleGraph *g, Module *m, Token tkn)
+{
+    // the path token keeps its quotes
+    cstr spelling  = m->file.contents + tkn.index + 1;
+    const uint len = tkn.length >= 2 ? tkn.length - 2 : 0;
+
+    char canonical[PATH_MAX];
+    if (len == 0 || !module_lookup(m->path, spelling, len, g->roots, g->root_count, canonical)) {
+        module_report_error(m, tkn.index, "Cannot find module", spelling, len,
+                            "Imports are looked up next to the importing file, then in every -I directory");
+        return FAILURE;
+    }
+
+    const ModuleIdx dep = module_add(g, canonical); // modules never move, only the array of them
+    array_push(m->imports, dep);
+    array_push(m->import_offsets, tkn.index);
+    return SUCCESS;
+}
+
+// imports of a parsed module, from the tree or from the cached flat layout
+internal u8
+module_resolve_imports(ModuleGraph *g, ModuleIdx idx)
+{
+    Module *m = module_at(g, idx);
+    u8 status = SUCCESS;
+
+    if (m->cache.base) {
+        const FlatAst *f  = &m->cache.flat;
+        uint count        = 0;
+        const NodeIdx *at = flat_run(f, f->decls, &count);
+        for (uint i = 0; i < count; i++)
+        {
+            if (flat_kind(f, at[i]) != AST_DECL_IMPORT) continue;
+            const Token tkn = tkn_at(&m->cache.tokens, flat_lhs(f, at[i]));
+            if (module_resolve_import(g, m, tkn) == FAILURE) status = FAILURE;
+        }
+        return status;
+    }
+
+    const Array(AstDeclPtr) decls = m->parser.ast->declarations;
+    for (usize i = 0; decls && i < array_count(decls); i++)
+    {
+        const AstDecl *decl = array_at(decls, i);
+        if (decl->kind != AST_DECL_IMPORT) continue;
+        if (module_resolve_import(g, m, decl->import.module_path) == FAILURE) status = FAILURE;
+    }
+    return status;
+}
+
+/*
+ *
+ * Ordering
+ *
+ */
+
+// walks imports among the unordered modules until one repeats
+internal void
+module_report_cycle(ModuleGraph *g, const uint *pending)
+{
+    const usize count = module_count(g);
+    uint *seen        = mem_alloc(sizeof(uint) * count); // step a module was seen at, + 1
+    memset(seen, 0, sizeof(uint) * count);
+    uint *path = mem_alloc(sizeof(uint) * (count + 1));
+
+    ModuleIdx at = 0;
+    while (!pending[at]) at++;
+
+    uint steps = 0;
+    while (!seen[at])
+    {
+        seen[at]       = steps + 1;
+        path[steps++]  = at;
+        const Module *m = module_at(g, at);
+        for (usize i = 0; i < array_count(m->imports); i++)
+        {
+            if (pending[array_at(m->imports, i)]) {
+                at = array_at(m->imports, i);
+                break;
+            }
+        }
+    }
+
+    // path[seen[at] - 1 ..] is the cycle, every hop is reported at its import
+    for (uint i = seen[at] - 1; i < steps; i++)
+    {
+        Module *m          = module_at(g, path[i]);
+        const ModuleIdx to = i + 1 < steps ? path[i + 1] : at;
+        for (usize k = 0; k < array_count(m->imports); k++)
+        {
+            if (array_at(m->imports, k) != to) continue;
+            const Module *dep = module_at(g, to);
+            module_report_error(m, array_at(m->import_offsets, k), "Import cycle through", dep->path,
+                                (uint)strlen(dep->path), "Move the shared declarations into a module both can import");
+            break;
+        }
+        m->st     = ST_MODULES;
+        m->status = FAILURE;
+    }
+
+    mem_free(seen);
+    mem_free(path);
+}
+
+// Kahn over the import edges, imports come before their importers
+internal u8
+module_graph_order(ModuleGraph *g)
+{
+    const usize count = module_count(g);
+    uint *pending     = mem_alloc(sizeof(uint) * count); // imports not ordered yet
+    uint *users_start = mem_alloc(sizeof(uint) * (count + 1));
+    memset(users_start, 0, sizeof(uint) * (count + 1));
+
+    usize edges = 0;
+    for (usize i = 0; i < count; i++)
+    {
+        const Module *m = module_at(g, i);
+        pending[i]      = (uint)array_count(m->imports);
+        for (usize k = 0; k < array_count(m->imports); k++) users_start[array_at(m->imports, k) + 1]++;
+        edges += array_count(m->imports);
+    }
+    for (usize i = 0; i < count; i++) users_start[i + 1] += users_start[i];
+
+    // importers of every module, grouped by the imported module
+    uint *users = mem_alloc(sizeof(uint) * (edges + 1));
+    uint *fill  = mem_alloc(sizeof(uint) * (count + 1));
+    memcpy(fill, users_start, sizeof(uint) * (count + 1));
+    for (usize i = 0; i < count; i++)
+    {
+        const Module *m = module_at(g, i);
+        for (usize k = 0; k < array_count(m->imports); k++) users[fill[array_at(m->imports, k)]++] = (uint)i;
+    }
+
+    g->order->count = 0;
+    for (usize i = 0; i < count; i++)
+    {
+        if (pending[i] == 0) array_push(g->order, (uint)i);
+    }
+
+    // one topological wave at a time, so level is the longest import chain
+    usize wave_start = 0;
+    g->levels        = 0;
+    while (wave_start < array_count(g->order))
+    {
+        const usize wave_end = array_count(g->order);
+        for (usize w = wave_start; w < wave_end; w++)
+        {
+            const ModuleIdx idx     = array_at(g->order, w);
+            module_at(g, idx)->level = g->levels;
+            for (uint u = users_start[idx]; u < users_start[idx + 1]; u++)
+            {
+                if (--pending[users[u]] == 0) array_push(g->order, users[u]);
+            }
+        }
+        wave_start = wave_end;
+        g->levels++;
+    }
+
+    const u8 status = array_count(g->order) == count ? SUCCESS : FAILURE;
+    if (status == FAILURE) module_report_cycle(g, pending);
+
+    mem_free(pending);
+    mem_free(users_start);
+    mem_free(users);
+    mem_free(fill);
+    return status;
+}
+
+u8
+module_graph_load(ModuleGraph *g, cstr entry, uint jobs)
+{
+    char canonical[PATH_MAX];
+    // a missing entry keeps its spelling so reading it reports the problem
+    module_add(g, module_canonical(entry, canonical) ? canonical : entry);
+
+    u8 status  = SUCCESS;
+    uint first = 0;
+    while (first < module_count(g))
+    {
+        const uint last = (uint)module_count(g);
+        ModuleWave wave = {g, first, last - first == 1 ? jobs : 1};
+        pool_run(jobs, last - first, module_load_task, &wave);
+
+        // resolved in discovery order so module numbering is stable
+        const TimeStamp start = time_now();
+        for (uint i = first; i < last; i++)
+        {
+            Module *m = module_at(g, i);
+            log_capture_flush(&m->diag);
+            if (m->status == SUCCESS && module_resolve_imports(g, i) == FAILURE) {
+                m->st     = ST_MODULES;
+                m->status = FAILURE;
+            }
+            if (m->status == FAILURE && status == SUCCESS) {
+                g->st  = m->st;
+                status = FAILURE;
+            }
+        }
+        const TimeSpan spent = time_since(start);
+        g->resolve.wall += spent.wall;
+        g->resolve.cpu += spent.cpu;
+        first = last;
+    }
+    if (status == FAILURE) return FAILURE;
+
+    const TimeStamp start = time_now();
+    status                = module_graph_order(g);
+    const TimeSpan spent  = time_since(start);
+    g->resolve.wall += spent.wall;
+    g->resolve.cpu += spent.cpu;
+    if (status == FAILURE) g->st = ST_MODULES;
+    return status;
+}
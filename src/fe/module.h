@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../include/intern.h"
+#include "cache.h"
+#include "checker.h"
+
+// Module graph
+// NOTE(5717): `x :: import "std/io"` names std/io.vr, looked up next to the
+// importing file first and then in every search root in order. Modules are
+// keyed by their canonical path (interned) so two spellings of one file load
+// once. Loading goes in discovery waves: the modules found by the previous
+// wave are read, lexed and parsed in parallel, then their imports resolve to
+// the next wave. The finished graph is ordered topologically (Kahn), whatever
+// cannot be ordered sits on an import cycle and is reported.
+typedef uint ModuleIdx;
+
+typedef struct
+{
+    cstr path; // canonical, owned by the graph
+    File file;
+    Lexer lexer;
+    Parser parser;
+    Checker checker;
+    CacheEntry cache;           // tokens and flat tree of a cache hit, lexer, parser and checker stay unused
+    Array(uint) imports;        // ModuleIdx of every import, in declaration order
+    Array(uint) import_offsets; // file offset of every import path
+    uint level;                 // topological wave, imports sit on lower levels
+    TimeSpan stages[ST_COUNT];  // file, lexer, parser and checker time
+    Stage st;                   // stage the module got to
+    u8 status;
+    LogCapture diag;
+} Module;
+
+typedef Module *ModulePtr;
+generate_array_type(ModulePtr);
+
+typedef struct
+{
+    Interner paths;           // canonical paths, sym - 1 is the ModuleIdx
+    Array(ModulePtr) modules; // by ModuleIdx, in discovery order
+    Array(uint) order;        // topological order, imports first
+    uint levels;              // number of topological waves
+    char **roots;             // searched after the importer directory
+    uint root_count;
+    cstr cache_dir;   // parse cache, nullptr when off
+    TimeSpan resolve; // resolving imports and ordering, the waves are timed per module
+    Stage st;         // stage of the first failure
+} ModuleGraph;
+
+ModuleGraph module_graph_make(char **roots, uint root_count);
+void module_graph_free(ModuleGraph *);
+// loads `entry` as module 0 and everything it imports, a single module wave
+// lexes with `jobs` threads, bigger waves give every module one thread
+u8 module_graph_load(ModuleGraph *, cstr entry, uint jobs);
+// canonical path of `spelling` imported from the file at `importer`, false when
+// there is no such file
+bool module_lookup(cstr importer, cstr spelling, uint length, char **roots, uint root_count,
+                   char canonical[PATH_MAX]);
+
+#define module_count(g)   array_count((g)->modules)
+#define module_at(g, idx) array_at((g)->modules, (idx))
@@ -3,12 +3,14 @@
 #include "type.h"
 #include "../include/mem.h"
 #include "../include/arraylist.h"
+#include "../include/pool.h"
 /*
  *
  * Internal private functions definitions
  *
  */
-internal u8 parse_director(Parser *);
+internal u8 parse_director(Parser *, TknIdx end);
+internal AstDecl *parse_declaration(Parser *);
 internal AstDecl *parse_import(Parser *);
 internal AstDecl *parse_function(Parser *);
 internal AstDecl *parse_struct(Parser *);
@@ -33,27 +35,28 @@ internal AstExpr *parse_call(Parser *);
 internal AstExpr *parse_primary(Parser *);
 internal AstType *parse_type(Parser *);
 
+// AST nodes are carved out of blocks of this size
+#define PARSER_ARENA_BLOCK_SIZE (256u << 10)
+
 // NOTE(5717): useful parser utils
-inline internal Token
-current(Parser *p)
+// kind of the token `offset` tokens away, reads only the packed kind bytes
+inline internal TknType
+peek_kind(Parser *p, uint offset)
 {
-    if (p->index >= array_count(p->lexer->tokens)) {
-        Token eof = {0};
-        eof.type = Tkn_EOT;
-        return eof;
-    }
-    return array_at(p->lexer->tokens, (p->index));
+    const TokenStream *tokens = &p->lexer->tokens;
+    if (p->index + offset >= tkn_count(tokens)) return Tkn_EOT;
+    return tkn_kind(tokens, p->index + offset);
 }
 
 inline internal Token
-next(Parser *p)
+current(Parser *p)
 {
-    if (p->index + 1 >= array_count(p->lexer->tokens)) {
+    if (p->index >= tkn_count(&p->lexer->tokens)) {
         Token eof = {0};
         eof.type = Tkn_EOT;
         return eof;
     }
-    return array_at(p->lexer->tokens, (p->index + 1));
+    return tkn_at(&p->lexer->tokens, p->index);
 }
 
 inline internal Token
@@ -64,13 +67,13 @@ previous(Parser *p)
         eof.type = Tkn_EOT;
         return eof;
     }
-    return array_at(p->lexer->tokens, (p->index - 1));
+    return tkn_at(&p->lexer->tokens, p->index - 1);
 }
 
 inline internal void
 advance(Parser *p)
 {
-    if (p->index < array_count(p->lexer->tokens)) {
+    if (p->index < tkn_count(&p->lexer->tokens)) {
         p->index++;
     }
 }
@@ -78,7 +81,7 @@ advance(Parser *p)
 inline internal bool
 check(Parser *p, TknType type)
 {
-    return current(p).type == type;
+    return peek_kind(p, 0) == type;
 }
 
 inline internal bool
@@ -94,8 +97,7 @@ match(Parser *p, TknType type)
 inline internal u8
 expect_n_consume(Parser *p, TknType t)
 {
-    Token tkn = current(p);
-    if (tkn.type == t)
+    if (check(p, t))
     {
         advance(p);
         return SUCCESS;
@@ -117,8 +119,36 @@ set_parser_error(Parser *p, ParseErr error)
 {
     p->error = error;
     Token curr = current(p);
-    p->error_line = curr.line;
-    p->error_col = curr.index + 1; // Convert to 1-based column numbering
+    p->error_offset = curr.index;
+}
+
+// node constructors for the parser, they keep the node count for the stats
+inline internal AstDecl *
+new_decl(Parser *p, AstNodeType kind, Token token)
+{
+    p->node_count++;
+    return ast_decl_create(&p->arena, kind, token);
+}
+
+inline internal AstStmt *
+new_stmt(Parser *p, AstNodeType kind, Token token)
+{
+    p->node_count++;
+    return ast_stmt_create(&p->arena, kind, token);
+}
+
+inline internal AstExpr *
+new_expr(Parser *p, AstNodeType kind, Token token)
+{
+    p->node_count++;
+    return ast_expr_create(&p->arena, kind, token);
+}
+
+inline internal AstType *
+new_type(Parser *p, AstNodeType kind, Token token)
+{
+    p->node_count++;
+    return ast_type_create(&p->arena, kind, token);
 }
 /*
  *
@@ -126,50 +156,44 @@ set_parser_error(Parser *p, ParseErr error)
  *
  */
 AstProgram *
-ast_program_create(void)
+ast_program_create(Arena *arena)
 {
-    AstProgram *program = mem_alloc(sizeof(AstProgram));
-    memset(program, 0, sizeof(AstProgram));
-    program->declarations = array_make(AstDeclPtr, 8);
+    AstProgram *program   = arena_alloc(arena, sizeof(AstProgram));
+    program->declarations = arena_array_make(arena, AstDeclPtr, 8);
     return program;
 }
 
 AstDecl *
-ast_decl_create(AstNodeType kind, Token token)
+ast_decl_create(Arena *arena, AstNodeType kind, Token token)
 {
-    AstDecl *decl = mem_alloc(sizeof(AstDecl));
-    memset(decl, 0, sizeof(AstDecl));
+    AstDecl *decl = arena_alloc(arena, sizeof(AstDecl));
     decl->kind = kind;
     decl->token = token;
     return decl;
 }
 
 AstStmt *
-ast_stmt_create(AstNodeType kind, Token token)
+ast_stmt_create(Arena *arena, AstNodeType kind, Token token)
 {
-    AstStmt *stmt = mem_alloc(sizeof(AstStmt));
-    memset(stmt, 0, sizeof(AstStmt));
+    AstStmt *stmt = arena_alloc(arena, sizeof(AstStmt));
     stmt->kind = kind;
     stmt->token = token;
     return stmt;
 }
 
 AstExpr *
-ast_expr_create(AstNodeType kind, Token token)
+ast_expr_create(Arena *arena, AstNodeType kind, Token token)
 {
-    AstExpr *expr = mem_alloc(sizeof(AstExpr));
-    memset(expr, 0, sizeof(AstExpr));
+    AstExpr *expr = arena_alloc(arena, sizeof(AstExpr));
     expr->kind = kind;
     expr->token = token;
-    expr->type = nullptr;
     return expr;
 }
 
 AstType *
-ast_type_create(AstNodeType kind, Token token)
+ast_type_create(Arena *arena, AstNodeType kind, Token token)
 {
-    AstType *type = mem_alloc(sizeof(AstType));
-    memset(type, 0, sizeof(AstType));
+    AstType *type = arena_alloc(arena, sizeof(AstType));
     type->kind = kind;
     type->token = token;
     return type;
@@ -177,268 +201,578 @@ ast_type_create(AstNodeType kind, Token token)
 
 /*
  *
- * AST Destruction Functions
+ * Public functions
  *
  */
+Parser
+parser_init(Lexer *l)
+{
+    Parser parser = {0};
+    parser.lexer = l;
+    parser.index = 0;
+    parser.ast = nullptr;
+    parser.error = PE_UNKNOWN;
+    parser.error_offset = 0;
+    parser.arena = arena_make(PARSER_ARENA_BLOCK_SIZE);
+    parser.spans = array_make(AstDeclSpan, 64);
+    return parser;
+}
+
+u8
+parser_parse(Parser *p)
+{
+    if (!p->ast) {
+        p->ast = ast_program_create(&p->arena);
+    }
+    const u8 status = parse_director(p, RUINT_MAX);
+    p->complete     = status == SUCCESS;
+    return status;
+}
+
 void
-ast_expr_free(AstExpr *expr)
+parser_deinit(Parser *p)
 {
-    if (!expr) return;
+    // the whole tree lives in the arena
+    arena_free(&p->arena);
+    array_free(p->spans);
+    p->ast   = nullptr;
+    p->spans = nullptr;
+}
+
+void
+parser_reset(Parser *p)
+{
+    arena_reset(&p->arena);
+    p->index        = 0;
+    p->ast          = nullptr;
+    p->error        = PE_UNKNOWN;
+    p->error_offset = 0;
+    p->node_count   = 0;
+    p->garbage      = 0;
+    p->complete     = false;
+    if (p->spans) array_count(p->spans) = 0;
+}
+
+/*
+ *
+ * internal functions
+ */
+
+AstDecl *
+parse_declaration(Parser *p)
+{
+    // Look ahead for patterns: identifier :: something
+    if (check(p, Tkn_Identifier) && 
+        peek_kind(p, 1) == Tkn_Colon &&
+        peek_kind(p, 2) == Tkn_Colon) {
+        
+        // identifier :: something - could be import, function, or constant
+        TknType third_token = peek_kind(p, 3);
+        if (third_token == Tkn_ImportKeyword) {
+            return parse_import(p);
+        } else if (third_token == Tkn_FnKeyword) {
+            return parse_function(p);
+        }
+        return parse_variable(p);
+    } else if (check(p, Tkn_Identifier) && 
+               peek_kind(p, 1) == Tkn_Colon) {
+        // identifier : something - could be := or : type = 
+        return parse_variable(p);
+    }
+
+    switch (peek_kind(p, 0)) {
+        case Tkn_ImportKeyword: 
+            return parse_import(p); 
+        case Tkn_FnKeyword: 
+            return parse_function(p); 
+        case Tkn_StructKeyword: 
+            return parse_struct(p); 
+        case Tkn_EnumKeyword: 
+            return parse_enum(p); 
+        case Tkn_LetKeyword: 
+            return parse_variable(p); 
+        default:
+            set_parser_error(p, PE_UNEXPECTED_TOKEN);
+            return nullptr;
+    }
+}
+
+// declarations starting before token `end`
+u8
+parse_director(Parser *p, TknIdx end)
+{
+    skip_terminators(p);
     
-    switch (expr->kind) {
-        case AST_EXPR_BINARY:
-            ast_expr_free(expr->binary.left);
-            ast_expr_free(expr->binary.right);
+    while (!check(p, Tkn_EOT) && p->index < end) {
+        const TknIdx first = p->index;
+        const uint nodes   = p->node_count;
+        AstDecl *decl      = parse_declaration(p);
+        if (!decl) {
+            return FAILURE;
+        }
+        
+        arena_array_push(&p->arena, p->ast->declarations, decl);
+        array_push(p->spans, ((AstDeclSpan){first, p->index, p->node_count - nodes}));
+        skip_terminators(p);
+    }
+    
+    return SUCCESS;
+}
+
+/*
+ *
+ * Chunked parallel parsing
+ * NOTE(5717): a top-level declaration starts after a terminator, outside
+ * any (), {} or [], with `name :` or a declaration keyword. The tokens are
+ * split at such starts and every chunk is parsed on its own Parser (arena,
+ * spans and diagnostics) up to the first declaration starting at or past its
+ * end. When a declaration of the previous chunk ran past a split, the chunk
+ * is parsed again serially from where the previous one really stopped. The
+ * chunks are stitched in order and their arenas handed to the parser, the
+ * tree, the spans and the diagnostics are the ones of parser_parse.
+ *
+ */
+#define PARSE_PARALLEL_MIN_TOKENS (1u << 20)
+#define PARSE_CHUNK_MIN_TOKENS    (1u << 17)
+
+typedef struct
+{
+    Parser parser;
+    TknIdx start, end; // speculative start, first token left to the next chunk
+    u8 status;
+    LogCapture diag;
+} ParseChunk;
+
+internal bool
+parse_chunk_can_start(const TokenStream *tokens, usize count, usize i)
+{
+    switch (tkn_kind(tokens, i))
+    {
+        case Tkn_Identifier:
+            return i + 1 < count && tkn_kind(tokens, i + 1) == Tkn_Colon;
+        case Tkn_ImportKeyword:
+        case Tkn_FnKeyword:
+        case Tkn_StructKeyword:
+        case Tkn_EnumKeyword:
+        case Tkn_LetKeyword:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// first tokens of at most `n` chunks of about the same size, returns how many
+internal uint
+parse_chunk_split(const TokenStream *tokens, usize count, TknIdx *starts, uint n)
+{
+    const u8 *kinds = tokens->kinds->elements;
+    uint found      = 1;
+    starts[0]       = 0;
+    int depth       = 0;
+    for (usize i = 0; i < count && found < n; i++)
+    {
+        if (depth == 0 && i >= count * found / n && kinds[i - 1] == Tkn_Terminator &&
+            parse_chunk_can_start(tokens, count, i)) {
+            starts[found++] = (TknIdx)i;
+        }
+        switch (kinds[i])
+        {
+            case Tkn_OpenParen:
+            case Tkn_OpenCurly:
+            case Tkn_OpenSQRBrackets:
+                depth++;
+                break;
+            case Tkn_CloseParen:
+            case Tkn_CloseCurly:
+            case Tkn_CloseSQRBrackets:
+                depth--;
+                break;
+            default:
+                break;
+        }
+    }
+    return found;
+}
+
+internal void
+parse_chunk_reset(ParseChunk *chunk, TknIdx start)
+{
+    Parser *p = &chunk->parser;
+    parser_reset(p);
+    p->ast       = ast_program_create(&p->arena);
+    p->index     = start;
+    chunk->start = start;
+    // diagnostics of a discarded speculative run
+    free(chunk->diag.text);
+    chunk->diag = (LogCapture){0};
+}
+
+internal void
+parse_chunk_run(ParseChunk *chunk)
+{
+    log_capture_begin(&chunk->diag);
+    chunk->status = parse_director(&chunk->parser, chunk->end);
+    log_capture_end(&chunk->diag);
+}
+
+internal void
+parse_chunk_task(void *ctx, uint index)
+{
+    parse_chunk_run((ParseChunk *)ctx + index);
+}
+
+u8
+parser_parse_parallel(Parser *p, uint jobs)
+{
+    const usize count = tkn_count(&p->lexer->tokens);
+    if (jobs < 2 || count < PARSE_PARALLEL_MIN_TOKENS) return parser_parse(p);
+
+    uint n = (uint)(count / PARSE_CHUNK_MIN_TOKENS);
+    if (n > jobs) n = jobs;
+    TknIdx *starts = mem_alloc(sizeof(TknIdx) * n);
+    n              = parse_chunk_split(&p->lexer->tokens, count, starts, n);
+    if (n < 2) {
+        mem_free(starts);
+        return parser_parse(p);
+    }
+
+    ParseChunk *chunks = mem_alloc(sizeof(ParseChunk) * n);
+    memset(chunks, 0, sizeof(ParseChunk) * n);
+    for (uint i = 0; i < n; i++)
+    {
+        chunks[i].parser = parser_init(p->lexer);
+        chunks[i].end    = i + 1 < n ? starts[i + 1] : (TknIdx)count;
+        parse_chunk_reset(&chunks[i], starts[i]);
+    }
+    mem_free(starts);
+
+    pool_run(jobs, n, parse_chunk_task, chunks);
+
+    // stitch in order, a chunk that started at the wrong token is redone
+    if (!p->ast) p->ast = ast_program_create(&p->arena);
+    u8 status       = SUCCESS;
+    TknIdx expected = 0;
+    for (uint i = 0; i < n; i++)
+    {
+        ParseChunk *chunk = &chunks[i];
+        Parser *c         = &chunk->parser;
+        if (chunk->start != expected) {
+            // the previous chunk ran past our split
+            if (expected >= chunk->end) continue;
+            parse_chunk_reset(chunk, expected);
+            parse_chunk_run(chunk);
+        }
+        log_capture_flush(&chunk->diag);
+
+        for (usize d = 0; d < array_count(c->ast->declarations); d++)
+            arena_array_push(&p->arena, p->ast->declarations, array_at(c->ast->declarations, d));
+        array_append(p->spans, c->spans->elements, array_count(c->spans));
+        p->node_count += c->node_count;
+        p->index = c->index;
+        arena_adopt(&p->arena, &c->arena);
+
+        if (chunk->status == FAILURE) {
+            p->error        = c->error;
+            p->error_offset = c->error_offset;
+            status          = FAILURE;
             break;
-        case AST_EXPR_UNARY:
-            ast_expr_free(expr->unary.operand);
+        }
+        expected = c->index;
+        if (check(p, Tkn_EOT)) break;
+    }
+
+    for (uint i = 0; i < n; i++)
+    {
+        free(chunks[i].diag.text);
+        parser_deinit(&chunks[i].parser);
+    }
+    mem_free(chunks);
+    p->complete = status == SUCCESS;
+    return status;
+}
+
+/*
+ *
+ * Incremental reparsing
+ * NOTE(5717): top-level declarations are parsed from their first token on
+ * and look at most PARSER_LOOKAHEAD tokens past their last one, so a
+ * declaration that ends (with its lookahead) before the changed tokens parses
+ * the same again and one starting after them parses the same from its new
+ * index. Parsing restarts after the last declaration kept in front and stops
+ * once a new declaration would start where an old one past the change moved
+ * to, the new declarations replace the old ones in between. The kept ones
+ * after the change hold Token copies with the offsets of the old text and
+ * are moved by the size change of the edit. Replaced nodes stay in the arena
+ * until there are more of them than live ones, then the file is parsed again
+ * from scratch.
+ *
+ */
+#define PARSER_LOOKAHEAD 4u
+
+internal void shift_decl(AstDecl *, i64);
+internal void shift_stmt(AstStmt *, i64);
+internal void shift_expr(AstExpr *, i64);
+internal void shift_type(AstType *, i64);
+
+// a zeroed Token was never set
+inline internal void
+shift_token(Token *t, i64 shift)
+{
+    if (t->index || t->length) t->index = (uint)((i64)t->index + shift);
+}
+
+internal void
+shift_decls(Array(AstDeclPtr) decls, i64 shift)
+{
+    for (usize i = 0; decls && i < array_count(decls); i++) shift_decl(array_at(decls, i), shift);
+}
+
+void
+shift_decl(AstDecl *decl, i64 shift)
+{
+    if (!decl) return;
+    shift_token(&decl->token, shift);
+    switch (decl->kind)
+    {
+        case AST_DECL_IMPORT:
+            shift_token(&decl->import.alias, shift);
+            shift_token(&decl->import.module_path, shift);
             break;
-        case AST_EXPR_CALL:
-            ast_expr_free(expr->call.callee);
-            for (usize i = 0; i < array_count(expr->call.arguments); i++) {
-                ast_expr_free(array_at(expr->call.arguments, i));
-            }
-            array_free(expr->call.arguments);
+        case AST_DECL_FUNCTION:
+            shift_token(&decl->function.name, shift);
+            shift_decls(decl->function.parameters, shift);
+            shift_type(decl->function.return_type, shift);
+            shift_stmt(decl->function.body, shift);
             break;
-        case AST_EXPR_MEMBER:
-            ast_expr_free(expr->member.object);
+        case AST_DECL_VARIABLE:
+            shift_token(&decl->variable.name, shift);
+            shift_type(decl->variable.type, shift);
+            shift_expr(decl->variable.initializer, shift);
             break;
-        case AST_EXPR_ASSIGN:
-            ast_expr_free(expr->assign.target);
-            ast_expr_free(expr->assign.value);
+        case AST_DECL_STRUCT:
+            shift_token(&decl->struct_decl.name, shift);
+            shift_decls(decl->struct_decl.fields, shift);
+            break;
+        case AST_DECL_ENUM:
+            shift_token(&decl->enum_decl.name, shift);
+            shift_decls(decl->enum_decl.members, shift);
             break;
         default:
             break;
     }
-    mem_free(expr);
 }
 
 void
-ast_stmt_free(AstStmt *stmt)
+shift_stmt(AstStmt *stmt, i64 shift)
 {
     if (!stmt) return;
-    
-    switch (stmt->kind) {
+    shift_token(&stmt->token, shift);
+    switch (stmt->kind)
+    {
         case AST_STMT_EXPR:
-            ast_expr_free(stmt->expr.expression);
+            shift_expr(stmt->expr.expression, shift);
             break;
         case AST_STMT_DECL:
-            ast_decl_free(stmt->decl.declaration);
+            shift_decl(stmt->decl.declaration, shift);
             break;
         case AST_STMT_IF:
-            ast_expr_free(stmt->if_stmt.condition);
-            ast_stmt_free(stmt->if_stmt.then_stmt);
-            ast_stmt_free(stmt->if_stmt.else_stmt);
+            shift_expr(stmt->if_stmt.condition, shift);
+            shift_stmt(stmt->if_stmt.then_stmt, shift);
+            shift_stmt(stmt->if_stmt.else_stmt, shift);
             break;
         case AST_STMT_WHILE:
-            ast_expr_free(stmt->while_stmt.condition);
-            ast_stmt_free(stmt->while_stmt.body);
+            shift_expr(stmt->while_stmt.condition, shift);
+            shift_stmt(stmt->while_stmt.body, shift);
             break;
         case AST_STMT_FOR:
-            ast_stmt_free(stmt->for_stmt.init);
-            ast_expr_free(stmt->for_stmt.condition);
-            ast_stmt_free(stmt->for_stmt.update);
-            ast_stmt_free(stmt->for_stmt.body);
+            shift_stmt(stmt->for_stmt.init, shift);
+            shift_expr(stmt->for_stmt.condition, shift);
+            shift_stmt(stmt->for_stmt.update, shift);
+            shift_stmt(stmt->for_stmt.body, shift);
             break;
         case AST_STMT_RETURN:
-            ast_expr_free(stmt->return_stmt.value);
+            shift_expr(stmt->return_stmt.value, shift);
             break;
         case AST_STMT_DEFER:
-            ast_stmt_free(stmt->defer_stmt.statement);
+            shift_stmt(stmt->defer_stmt.statement, shift);
             break;
         case AST_STMT_BLOCK:
-            for (usize i = 0; i < array_count(stmt->block.statements); i++) {
-                ast_stmt_free(array_at(stmt->block.statements, i));
-            }
-            array_free(stmt->block.statements);
+            for (usize i = 0; i < array_count(stmt->block.statements); i++)
+                shift_stmt(array_at(stmt->block.statements, i), shift);
             break;
         default:
             break;
     }
-    mem_free(stmt);
 }
 
 void
-ast_decl_free(AstDecl *decl)
+shift_expr(AstExpr *expr, i64 shift)
 {
-    if (!decl) return;
-    
-    switch (decl->kind) {
-        case AST_DECL_IMPORT:
-            // Import declarations only contain token references, no additional cleanup needed
+    if (!expr) return;
+    shift_token(&expr->token, shift);
+    switch (expr->kind)
+    {
+        case AST_EXPR_LITERAL:
+            shift_token(&expr->literal.value, shift);
             break;
-        case AST_DECL_FUNCTION:
-            for (usize i = 0; i < array_count(decl->function.parameters); i++) {
-                ast_decl_free(array_at(decl->function.parameters, i));
-            }
-            array_free(decl->function.parameters);
-            ast_type_free(decl->function.return_type);
-            ast_stmt_free(decl->function.body);
+        case AST_EXPR_IDENTIFIER:
+            shift_token(&expr->identifier.name, shift);
             break;
-        case AST_DECL_VARIABLE:
-            ast_type_free(decl->variable.type);
-            ast_expr_free(decl->variable.initializer);
+        case AST_EXPR_BINARY:
+            shift_expr(expr->binary.left, shift);
+            shift_token(&expr->binary.operator, shift);
+            shift_expr(expr->binary.right, shift);
             break;
-        case AST_DECL_STRUCT:
-            for (usize i = 0; i < array_count(decl->struct_decl.fields); i++) {
-                ast_decl_free(array_at(decl->struct_decl.fields, i));
-            }
-            array_free(decl->struct_decl.fields);
+        case AST_EXPR_UNARY:
+            shift_token(&expr->unary.operator, shift);
+            shift_expr(expr->unary.operand, shift);
             break;
-        case AST_DECL_ENUM:
-            for (usize i = 0; i < array_count(decl->enum_decl.members); i++) {
-                ast_decl_free(array_at(decl->enum_decl.members, i));
-            }
-            array_free(decl->enum_decl.members);
+        case AST_EXPR_CALL:
+            shift_expr(expr->call.callee, shift);
+            for (usize i = 0; i < array_count(expr->call.arguments); i++)
+                shift_expr(array_at(expr->call.arguments, i), shift);
+            break;
+        case AST_EXPR_MEMBER:
+            shift_expr(expr->member.object, shift);
+            shift_token(&expr->member.member, shift);
+            break;
+        case AST_EXPR_ASSIGN:
+            shift_expr(expr->assign.target, shift);
+            shift_token(&expr->assign.operator, shift);
+            shift_expr(expr->assign.value, shift);
             break;
         default:
             break;
     }
-    mem_free(decl);
 }
 
 void
-ast_type_free(AstType *type)
+shift_type(AstType *type, i64 shift)
 {
     if (!type) return;
-    
-    switch (type->kind) {
+    shift_token(&type->token, shift);
+    switch (type->kind)
+    {
+        case AST_TYPE_BASIC:
+            // user types keep their name where basic ones keep the BaseType
+            if (type->token.type == Tkn_Identifier) shift_token(&type->user_defined.name, shift);
+            break;
         case AST_TYPE_ARRAY:
-            ast_type_free(type->array.element_type);
-            ast_expr_free(type->array.size);
+            shift_type(type->array.element_type, shift);
+            shift_expr(type->array.size, shift);
             break;
         case AST_TYPE_FUNCTION:
-            for (usize i = 0; i < array_count(type->function.param_types); i++) {
-                ast_type_free(array_at(type->function.param_types, i));
-            }
-            array_free(type->function.param_types);
-            ast_type_free(type->function.return_type);
+            for (usize i = 0; type->function.param_types && i < array_count(type->function.param_types); i++)
+                shift_type(array_at(type->function.param_types, i), shift);
+            shift_type(type->function.return_type, shift);
             break;
         default:
             break;
     }
-    mem_free(type);
 }
 
-void
-ast_program_free(AstProgram *program)
+// first of `count` spans ending (with the lookahead) after token `index`
+internal usize
+reparse_first(const AstDeclSpan *spans, usize count, TknIdx index)
 {
-    if (!program) return;
-    
-    for (usize i = 0; i < array_count(program->declarations); i++) {
-        ast_decl_free(array_at(program->declarations, i));
+    usize lo = 0, hi = count;
+    while (lo < hi)
+    {
+        const usize mid = lo + (hi - lo) / 2;
+        if (spans[mid].end + PARSER_LOOKAHEAD <= index) lo = mid + 1;
+        else hi = mid;
     }
-    array_free(program->declarations);
-    mem_free(program);
+    return lo;
 }
 
-/*
- *
- * Public functions
- *
- */
-Parser
-parser_init(Lexer *l)
+// first of spans [from, count) starting at or after token `index`
+internal usize
+reparse_tail(const AstDeclSpan *spans, usize from, usize count, TknIdx index)
 {
-    Parser parser = {0};
-    parser.lexer = l;
-    parser.index = 0;
-    parser.ast = nullptr;
-    parser.error = PE_UNKNOWN;
-    parser.error_line = 1;
-    parser.error_col = 1;
-    return parser;
-}
-
-u8
-parser_parse(Parser *p)
-{
-    if (!p->ast) {
-        p->ast = ast_program_create();
+    usize lo = from, hi = count;
+    while (lo < hi)
+    {
+        const usize mid = lo + (hi - lo) / 2;
+        if (spans[mid].first < index) lo = mid + 1;
+        else hi = mid;
     }
-    return parse_director(p);
+    return lo;
 }
 
-void
-parser_deinit(Parser *p)
+u8
+parser_reparse(Parser *p, TknEdit changed, i64 shift)
 {
-    if (p->ast) {
-        ast_program_free(p->ast);
-        p->ast = nullptr;
+    if (!p->complete || !p->ast || p->garbage > p->node_count) {
+        parser_reset(p);
+        return parser_parse(p);
     }
-}
+    p->complete     = false; // until the new declarations are in
+    p->error        = PE_UNKNOWN;
+    p->error_offset = 0;
 
-/*
- *
- * internal functions
- */
+    const AstDeclSpan *spans = p->spans->elements;
+    const usize count        = array_count(p->spans);
+    const i64 moved          = (i64)changed.inserted - (i64)changed.removed;
+    const usize first        = reparse_first(spans, count, changed.from);
+    usize next               = reparse_tail(spans, first, count, changed.from + changed.removed);
 
-u8
-parse_director(Parser *p)
-{
+    Array(AstDeclPtr) decls   = array_make(AstDeclPtr, 8);
+    Array(AstDeclSpan) parsed = array_make(AstDeclSpan, 8);
+    p->index                  = first ? spans[first - 1].end : 0;
     skip_terminators(p);
-    
-    while (!check(p, Tkn_EOT)) {
-        AstDecl *decl = nullptr;
-        
-        // Look ahead for patterns: identifier :: something
-        if (check(p, Tkn_Identifier) && 
-            p->index + 1 < array_count(p->lexer->tokens) && 
-            array_at(p->lexer->tokens, p->index + 1).type == Tkn_Colon &&
-            p->index + 2 < array_count(p->lexer->tokens) &&
-            array_at(p->lexer->tokens, p->index + 2).type == Tkn_Colon) {
-            
-            // identifier :: something - could be import, function, or constant
-            if (p->index + 3 < array_count(p->lexer->tokens)) {
-                TknType third_token = array_at(p->lexer->tokens, p->index + 3).type;
-                if (third_token == Tkn_ImportKeyword) {
-                    decl = parse_import(p);
-                } else if (third_token == Tkn_FnKeyword) {
-                    decl = parse_function(p);
-                } else {
-                    decl = parse_variable(p);
-                }
-            } else {
-                decl = parse_variable(p);
-            }
-        } else if (check(p, Tkn_Identifier) && 
-                   p->index + 1 < array_count(p->lexer->tokens) && 
-                   array_at(p->lexer->tokens, p->index + 1).type == Tkn_Colon) {
-            // identifier : something - could be := or : type = 
-            decl = parse_variable(p);
-        } else {
-            switch (current(p).type) {
-                case Tkn_ImportKeyword: 
-                    decl = parse_import(p); 
-                    break;
-                case Tkn_FnKeyword: 
-                    decl = parse_function(p); 
-                    break;
-                case Tkn_StructKeyword: 
-                    decl = parse_struct(p); 
-                    break;
-                case Tkn_EnumKeyword: 
-                    decl = parse_enum(p); 
-                    break;
-                case Tkn_LetKeyword: 
-                    decl = parse_variable(p); 
-                    break;
-                case Tkn_EOT: 
-                    return SUCCESS;
-                default:
-                    set_parser_error(p, PE_UNEXPECTED_TOKEN);
-                    return FAILURE;
-            }
-        }
-        
+    while (!check(p, Tkn_EOT))
+    {
+        // an old declaration past the change starts here, it and the rest are kept
+        while (next < count && (i64)spans[next].first + moved < (i64)p->index) next++;
+        if (next < count && (i64)spans[next].first + moved == (i64)p->index) break;
+
+        const TknIdx start = p->index;
+        const uint nodes   = p->node_count;
+        AstDecl *decl      = parse_declaration(p);
         if (!decl) {
+            array_free(parsed);
+            array_free(decls);
             return FAILURE;
         }
-        
-        array_push(p->ast->declarations, decl);
+        array_push(decls, decl);
+        array_push(parsed, ((AstDeclSpan){start, p->index, p->node_count - nodes}));
         skip_terminators(p);
     }
-    
+    const usize last = check(p, Tkn_EOT) ? count : next;
+
+    // the nodes of the replaced declarations no longer count
+    for (usize i = first; i < last; i++)
+    {
+        p->node_count -= spans[i].nodes;
+        p->garbage += spans[i].nodes;
+    }
+    for (usize i = last; i < count; i++)
+    {
+        shift_decl(array_at(p->ast->declarations, i), shift);
+        p->spans->elements[i].first = (TknIdx)((i64)spans[i].first + moved);
+        p->spans->elements[i].end   = (TknIdx)((i64)spans[i].end + moved);
+    }
+
+    // declarations [first, last) become the new ones, in place when they fit
+    Array(AstDeclPtr) program = p->ast->declarations;
+    const usize added         = array_count(decls);
+    const usize total         = count - (last - first) + added;
+    if (total > program->capacity) {
+        Array(AstDeclPtr) grown = arena_array_make(&p->arena, AstDeclPtr, total + total / 2);
+        memcpy(grown->elements, program->elements, first * sizeof(AstDeclPtr));
+        memcpy(grown->elements + first + added, program->elements + last, (count - last) * sizeof(AstDeclPtr));
+        program = grown;
+    } else {
+        memmove(program->elements + first + added, program->elements + last, (count - last) * sizeof(AstDeclPtr));
+    }
+    memcpy(program->elements + first, decls->elements, added * sizeof(AstDeclPtr));
+    program->count          = total;
+    p->ast->declarations    = program;
+    array_splice(p->spans, first, last, parsed->elements, added);
+
+    array_free(parsed);
+    array_free(decls);
+    p->complete = true;
     return SUCCESS;
 }
 
@@ -447,12 +781,11 @@ parse_import(Parser *p)
 {
     // Parse: alias :: import "module/path"
     Token alias_token = current(p);
-    AstDecl *import_decl = ast_decl_create(AST_DECL_IMPORT, alias_token);
+    AstDecl *import_decl = new_decl(p, AST_DECL_IMPORT, alias_token);
     
     // Expect identifier alias
     if (!check(p, Tkn_Identifier)) {
         set_parser_error(p, PE_EXPECTED_IDENTIFIER);
-        ast_decl_free(import_decl);
         return nullptr;
     }
     
@@ -462,20 +795,17 @@ parse_import(Parser *p)
     // Expect ::
     if (!match(p, Tkn_Colon) || !match(p, Tkn_Colon)) {
         set_parser_error(p, PE_UNEXPECTED_TOKEN);
-        ast_decl_free(import_decl);
         return nullptr;
     }
     
     // Expect import keyword
     if (!match(p, Tkn_ImportKeyword)) {
         set_parser_error(p, PE_UNEXPECTED_TOKEN);
-        ast_decl_free(import_decl);
         return nullptr;
     }
     
     if (!check(p, Tkn_StringLiteral)) {
         set_parser_error(p, PE_EXPECTED_EXPRESSION);
-        ast_decl_free(import_decl);
         return nullptr;
     }
     
@@ -489,8 +819,8 @@ AstDecl *
 parse_function(Parser *p)
 {
     Token func_token = current(p);
-    AstDecl *func_decl = ast_decl_create(AST_DECL_FUNCTION, func_token);
-    func_decl->function.parameters = array_make(AstDeclPtr, 4);
+    AstDecl *func_decl = new_decl(p, AST_DECL_FUNCTION, func_token);
+    func_decl->function.parameters = arena_array_make(&p->arena, AstDeclPtr, 4);
     
     // Parse: name :: fn(params) return_type { body }
     // or: fn name(params) return_type { body }
@@ -501,14 +831,12 @@ parse_function(Parser *p)
         
         if (!match(p, Tkn_Colon) || !match(p, Tkn_Colon)) {
             log_error("Expected '::' after function name");
-            ast_decl_free(func_decl);
             return nullptr;
         }
     }
     
     if (!match(p, Tkn_FnKeyword)) {
         log_error("Expected 'fn' keyword");
-        ast_decl_free(func_decl);
         return nullptr;
     }
     
@@ -517,7 +845,6 @@ parse_function(Parser *p)
     if (func_decl->function.name.index == 0 && func_decl->function.name.length == 0) {
         if (!check(p, Tkn_Identifier)) {
             log_error("Expected function name");
-            ast_decl_free(func_decl);
             return nullptr;
         }
         func_decl->function.name = current(p);
@@ -527,31 +854,36 @@ parse_function(Parser *p)
     // Parse parameters
     if (!match(p, Tkn_OpenParen)) {
         log_error("Expected '(' after function name");
-        ast_decl_free(func_decl);
         return nullptr;
     }
     
     while (!check(p, Tkn_CloseParen) && !check(p, Tkn_EOT)) {
         if (!check(p, Tkn_Identifier)) {
             log_error("Expected parameter name");
-            ast_decl_free(func_decl);
             return nullptr;
         }
         
-        AstDecl *param = ast_decl_create(AST_DECL_VARIABLE, current(p));
+        // names are interned, equal spellings have equal syms
+        const Sym name = current(p).sym;
+        for_each(func_decl->function.parameters, other) {
+            if ((*other)->variable.name.sym == name) {
+                set_parser_error(p, PE_DUPLICATE_PARAMETER);
+                return nullptr;
+            }
+        }
+        
+        AstDecl *param = new_decl(p, AST_DECL_VARIABLE, current(p));
         param->variable.name = current(p);
         advance(p);
         
         if (match(p, Tkn_Colon)) {
             param->variable.type = parse_type(p);
             if (!param->variable.type) {
-                ast_decl_free(param);
-                ast_decl_free(func_decl);
                 return nullptr;
             }
         }
         
-        array_push(func_decl->function.parameters, param);
+        arena_array_push(&p->arena, func_decl->function.parameters, param);
         
         if (!match(p, Tkn_Comma)) {
             break;
@@ -560,7 +892,6 @@ parse_function(Parser *p)
     
     if (!match(p, Tkn_CloseParen)) {
         log_error("Expected ')' after parameters");
-        ast_decl_free(func_decl);
         return nullptr;
     }
     
@@ -568,7 +899,6 @@ parse_function(Parser *p)
     if (!check(p, Tkn_OpenCurly)) {
         func_decl->function.return_type = parse_type(p);
         if (!func_decl->function.return_type) {
-            ast_decl_free(func_decl);
             return nullptr;
         }
     }
@@ -576,7 +906,6 @@ parse_function(Parser *p)
     // Parse body
     func_decl->function.body = parse_block(p);
     if (!func_decl->function.body) {
-        ast_decl_free(func_decl);
         return nullptr;
     }
     
@@ -587,7 +916,7 @@ AstDecl *
 parse_variable(Parser *p)
 {
     Token var_token = current(p);
-    AstDecl *var_decl = ast_decl_create(AST_DECL_VARIABLE, var_token);
+    AstDecl *var_decl = new_decl(p, AST_DECL_VARIABLE, var_token);
     var_decl->variable.is_constant = false;
     
     bool has_let = false;
@@ -597,7 +926,6 @@ parse_variable(Parser *p)
     
     if (!check(p, Tkn_Identifier)) {
         log_error("Expected variable name");
-        ast_decl_free(var_decl);
         return nullptr;
     }
     
@@ -612,48 +940,42 @@ parse_variable(Parser *p)
             // : - typed variable
             var_decl->variable.type = parse_type(p);
             if (!var_decl->variable.type) {
-                ast_decl_free(var_decl);
                 return nullptr;
             }
             
             if (!match(p, Tkn_Equal)) {
                 log_error("Expected '=' after variable type");
-                ast_decl_free(var_decl);
                 return nullptr;
             }
         }
     } else if (!has_let) {
         // Check if we're at a colon (for :=) or if tokens were already consumed
         if (check(p, Tkn_Colon)) {
-            if (next(p).type == Tkn_Equal) {
+            if (peek_kind(p, 1) == Tkn_Equal) {
                 // x := value
                 advance(p); // consume :
                 advance(p); // consume =
-            } else if (next(p).type == Tkn_Colon) {
+            } else if (peek_kind(p, 1) == Tkn_Colon) {
                 // x :: value (constant)
                 advance(p); // consume :
                 advance(p); // consume :
                 var_decl->variable.is_constant = true;
             } else {
                 log_error("Expected ':=' or '::' for variable declaration");
-                ast_decl_free(var_decl);
                 return nullptr;
             }
         } else {
             log_error("Expected ':' after variable name");
-            ast_decl_free(var_decl);
             return nullptr;
         }
     } else {
         log_error("Expected ':' after variable name");
-        ast_decl_free(var_decl);
         return nullptr;
     }
     
     // Parse initializer
     var_decl->variable.initializer = parse_expression(p);
     if (!var_decl->variable.initializer) {
-        ast_decl_free(var_decl);
         return nullptr;
     }
     
@@ -666,12 +988,11 @@ parse_struct(Parser *p)
     Token struct_token = current(p);
     advance(p); // consume 'struct'
     
-    AstDecl *struct_decl = ast_decl_create(AST_DECL_STRUCT, struct_token);
-    struct_decl->struct_decl.fields = array_make(AstDeclPtr, 8);
+    AstDecl *struct_decl = new_decl(p, AST_DECL_STRUCT, struct_token);
+    struct_decl->struct_decl.fields = arena_array_make(&p->arena, AstDeclPtr, 8);
     
     if (!check(p, Tkn_Identifier)) {
         log_error("Expected struct name");
-        ast_decl_free(struct_decl);
         return nullptr;
     }
     
@@ -680,7 +1001,6 @@ parse_struct(Parser *p)
     
     if (!match(p, Tkn_OpenCurly)) {
         log_error("Expected '{' after struct name");
-        ast_decl_free(struct_decl);
         return nullptr;
     }
     
@@ -689,35 +1009,29 @@ parse_struct(Parser *p)
         
         if (!check(p, Tkn_Identifier)) {
             log_error("Expected field name");
-            ast_decl_free(struct_decl);
             return nullptr;
         }
         
-        AstDecl *field = ast_decl_create(AST_DECL_VARIABLE, current(p));
+        AstDecl *field = new_decl(p, AST_DECL_VARIABLE, current(p));
         field->variable.name = current(p);
         advance(p);
         
         if (!match(p, Tkn_Colon)) {
             log_error("Expected ':' after field name");
-            ast_decl_free(field);
-            ast_decl_free(struct_decl);
             return nullptr;
         }
         
         field->variable.type = parse_type(p);
         if (!field->variable.type) {
-            ast_decl_free(field);
-            ast_decl_free(struct_decl);
             return nullptr;
         }
         
-        array_push(struct_decl->struct_decl.fields, field);
+        arena_array_push(&p->arena, struct_decl->struct_decl.fields, field);
         skip_terminators(p);
     }
     
     if (!match(p, Tkn_CloseCurly)) {
         log_error("Expected '}' after struct fields");
-        ast_decl_free(struct_decl);
         return nullptr;
     }
     
@@ -730,12 +1044,11 @@ parse_enum(Parser *p)
     Token enum_token = current(p);
     advance(p); // consume 'enum'
     
-    AstDecl *enum_decl = ast_decl_create(AST_DECL_ENUM, enum_token);
-    enum_decl->enum_decl.members = array_make(AstDeclPtr, 8);
+    AstDecl *enum_decl = new_decl(p, AST_DECL_ENUM, enum_token);
+    enum_decl->enum_decl.members = arena_array_make(&p->arena, AstDeclPtr, 8);
     
     if (!check(p, Tkn_Identifier)) {
         log_error("Expected enum name");
-        ast_decl_free(enum_decl);
         return nullptr;
     }
     
@@ -744,7 +1057,6 @@ parse_enum(Parser *p)
     
     if (!match(p, Tkn_OpenCurly)) {
         log_error("Expected '{' after enum name");
-        ast_decl_free(enum_decl);
         return nullptr;
     }
     
@@ -753,15 +1065,14 @@ parse_enum(Parser *p)
         
         if (!check(p, Tkn_Identifier)) {
             log_error("Expected enum member name");
-            ast_decl_free(enum_decl);
             return nullptr;
         }
         
-        AstDecl *member = ast_decl_create(AST_DECL_VARIABLE, current(p));
+        AstDecl *member = new_decl(p, AST_DECL_VARIABLE, current(p));
         member->variable.name = current(p);
         advance(p);
         
-        array_push(enum_decl->enum_decl.members, member);
+        arena_array_push(&p->arena, enum_decl->enum_decl.members, member);
         
         if (!match(p, Tkn_Comma)) {
             break;
@@ -771,7 +1082,6 @@ parse_enum(Parser *p)
     
     if (!match(p, Tkn_CloseCurly)) {
         log_error("Expected '}' after enum members");
-        ast_decl_free(enum_decl);
         return nullptr;
     }
     
@@ -782,7 +1092,7 @@ parse_enum(Parser *p)
 AstStmt *
 parse_statement(Parser *p)
 {
-    switch (current(p).type) {
+    switch (peek_kind(p, 0)) {
         case Tkn_IfKeyword:
             return parse_if_statement(p);
         case Tkn_WhileKeyword:
@@ -797,23 +1107,21 @@ parse_statement(Parser *p)
             AstDecl *var_decl = parse_variable(p);
             if (!var_decl) return nullptr;
             
-            AstStmt *stmt = ast_stmt_create(AST_STMT_DECL, var_decl->token);
+            AstStmt *stmt = new_stmt(p, AST_STMT_DECL, var_decl->token);
             stmt->decl.declaration = var_decl;
             return stmt;
         }
         default: {
             // Check if this might be a variable declaration: identifier : type = value
             if (check(p, Tkn_Identifier) && 
-                p->index + 1 < array_count(p->lexer->tokens) && 
-                array_at(p->lexer->tokens, p->index + 1).type == Tkn_Colon &&
-                p->index + 2 < array_count(p->lexer->tokens) &&
-                array_at(p->lexer->tokens, p->index + 2).type != Tkn_Equal &&
-                array_at(p->lexer->tokens, p->index + 2).type != Tkn_Colon) {
+                peek_kind(p, 1) == Tkn_Colon &&
+                peek_kind(p, 2) != Tkn_Equal &&
+                peek_kind(p, 2) != Tkn_Colon) {
                 // This looks like a typed variable declaration
                 AstDecl *var_decl = parse_variable(p);
                 if (!var_decl) return nullptr;
                 
-                AstStmt *stmt = ast_stmt_create(AST_STMT_DECL, var_decl->token);
+                AstStmt *stmt = new_stmt(p, AST_STMT_DECL, var_decl->token);
                 stmt->decl.declaration = var_decl;
                 return stmt;
             }
@@ -822,7 +1130,7 @@ parse_statement(Parser *p)
             AstExpr *expr = parse_expression(p);
             if (!expr) return nullptr;
             
-            AstStmt *stmt = ast_stmt_create(AST_STMT_EXPR, expr->token);
+            AstStmt *stmt = new_stmt(p, AST_STMT_EXPR, expr->token);
             stmt->expr.expression = expr;
             return stmt;
         }
@@ -838,25 +1146,23 @@ parse_block(Parser *p)
         return nullptr;
     }
     
-    AstStmt *block = ast_stmt_create(AST_STMT_BLOCK, brace_token);
-    block->block.statements = array_make(AstStmtPtr, 8);
+    AstStmt *block = new_stmt(p, AST_STMT_BLOCK, brace_token);
+    block->block.statements = arena_array_make(&p->arena, AstStmtPtr, 8);
     
     while (!check(p, Tkn_CloseCurly) && !check(p, Tkn_EOT)) {
         skip_terminators(p);
         
         AstStmt *stmt = parse_statement(p);
         if (!stmt) {
-            ast_stmt_free(block);
             return nullptr;
         }
         
-        array_push(block->block.statements, stmt);
+        arena_array_push(&p->arena, block->block.statements, stmt);
         skip_terminators(p);
     }
     
     if (!match(p, Tkn_CloseCurly)) {
         log_error("Expected '}'");
-        ast_stmt_free(block);
         return nullptr;
     }
     
@@ -869,33 +1175,29 @@ parse_if_statement(Parser *p)
     Token if_token = current(p);
     advance(p); // consume 'if'
     
-    AstStmt *if_stmt = ast_stmt_create(AST_STMT_IF, if_token);
+    AstStmt *if_stmt = new_stmt(p, AST_STMT_IF, if_token);
     
     // Support both `if (condition)` and `if condition` syntax
     bool has_parens = match(p, Tkn_OpenParen);
     
     if_stmt->if_stmt.condition = parse_expression(p);
     if (!if_stmt->if_stmt.condition) {
-        ast_stmt_free(if_stmt);
         return nullptr;
     }
     
     if (has_parens && !match(p, Tkn_CloseParen)) {
         log_error("Expected ')' after if condition");
-        ast_stmt_free(if_stmt);
         return nullptr;
     }
     
     if_stmt->if_stmt.then_stmt = parse_statement(p);
     if (!if_stmt->if_stmt.then_stmt) {
-        ast_stmt_free(if_stmt);
         return nullptr;
     }
     
     if (match(p, Tkn_ElseKeyword)) {
         if_stmt->if_stmt.else_stmt = parse_statement(p);
         if (!if_stmt->if_stmt.else_stmt) {
-            ast_stmt_free(if_stmt);
             return nullptr;
         }
     }
@@ -909,29 +1211,25 @@ parse_while_statement(Parser *p)
     Token while_token = current(p);
     advance(p); // consume 'while'
     
-    AstStmt *while_stmt = ast_stmt_create(AST_STMT_WHILE, while_token);
+    AstStmt *while_stmt = new_stmt(p, AST_STMT_WHILE, while_token);
     
     if (!match(p, Tkn_OpenParen)) {
         log_error("Expected '(' after 'while'");
-        ast_stmt_free(while_stmt);
         return nullptr;
     }
     
     while_stmt->while_stmt.condition = parse_expression(p);
     if (!while_stmt->while_stmt.condition) {
-        ast_stmt_free(while_stmt);
         return nullptr;
     }
     
     if (!match(p, Tkn_CloseParen)) {
         log_error("Expected ')' after while condition");
-        ast_stmt_free(while_stmt);
         return nullptr;
     }
     
     while_stmt->while_stmt.body = parse_statement(p);
     if (!while_stmt->while_stmt.body) {
-        ast_stmt_free(while_stmt);
         return nullptr;
     }
     
@@ -944,7 +1242,7 @@ parse_for_statement(Parser *p)
     Token for_token = current(p);
     advance(p); // consume 'for'
     
-    AstStmt *for_stmt = ast_stmt_create(AST_STMT_FOR, for_token);
+    AstStmt *for_stmt = new_stmt(p, AST_STMT_FOR, for_token);
     
     // Check for new syntax: for i in 0..3
     if (check(p, Tkn_Identifier)) {
@@ -953,26 +1251,24 @@ parse_for_statement(Parser *p)
         
         if (!match(p, Tkn_InKeyword)) {
             log_error("Expected 'in' after for loop variable");
-            ast_stmt_free(for_stmt);
             return nullptr;
         }
         
         // Parse the range expression (e.g., 0..3)
         AstExpr *range_expr = parse_expression(p);
         if (!range_expr) {
-            ast_stmt_free(for_stmt);
             return nullptr;
         }
         
         // For now, map the new syntax to the old structure
         // Create a variable declaration for the loop variable
-        AstDecl *var_decl = ast_decl_create(AST_DECL_VARIABLE, variable_token);
+        AstDecl *var_decl = new_decl(p, AST_DECL_VARIABLE, variable_token);
         var_decl->variable.name = variable_token;
         var_decl->variable.type = NULL; // Type will be inferred
         var_decl->variable.initializer = NULL; // No initial value in the declaration
         var_decl->variable.is_constant = false;
         
-        AstStmt *init_stmt = ast_stmt_create(AST_STMT_DECL, variable_token);
+        AstStmt *init_stmt = new_stmt(p, AST_STMT_DECL, variable_token);
         init_stmt->decl.declaration = var_decl;
         
         for_stmt->for_stmt.init = init_stmt;
@@ -981,7 +1277,6 @@ parse_for_statement(Parser *p)
         
         for_stmt->for_stmt.body = parse_statement(p);
         if (!for_stmt->for_stmt.body) {
-            ast_stmt_free(for_stmt);
             return nullptr;
         }
         
@@ -991,7 +1286,6 @@ parse_for_statement(Parser *p)
     // Fallback to C-style for loop syntax: for (init; condition; update)
     if (!match(p, Tkn_OpenParen)) {
         log_error("Expected '(' after 'for'");
-        ast_stmt_free(for_stmt);
         return nullptr;
     }
     
@@ -999,7 +1293,6 @@ parse_for_statement(Parser *p)
     if (!check(p, Tkn_Terminator)) {
         for_stmt->for_stmt.init = parse_statement(p);
         if (!for_stmt->for_stmt.init) {
-            ast_stmt_free(for_stmt);
             return nullptr;
         }
     }
@@ -1009,7 +1302,6 @@ parse_for_statement(Parser *p)
     if (!check(p, Tkn_Terminator)) {
         for_stmt->for_stmt.condition = parse_expression(p);
         if (!for_stmt->for_stmt.condition) {
-            ast_stmt_free(for_stmt);
             return nullptr;
         }
     }
@@ -1019,20 +1311,17 @@ parse_for_statement(Parser *p)
     if (!check(p, Tkn_CloseParen)) {
         for_stmt->for_stmt.update = parse_statement(p);
         if (!for_stmt->for_stmt.update) {
-            ast_stmt_free(for_stmt);
             return nullptr;
         }
     }
     
     if (!match(p, Tkn_CloseParen)) {
         log_error("Expected ')' after for clauses");
-        ast_stmt_free(for_stmt);
         return nullptr;
     }
     
     for_stmt->for_stmt.body = parse_statement(p);
     if (!for_stmt->for_stmt.body) {
-        ast_stmt_free(for_stmt);
         return nullptr;
     }
     
@@ -1045,12 +1334,11 @@ parse_return_statement(Parser *p)
     Token ret_token = current(p);
     advance(p); // consume 'ret'
     
-    AstStmt *ret_stmt = ast_stmt_create(AST_STMT_RETURN, ret_token);
+    AstStmt *ret_stmt = new_stmt(p, AST_STMT_RETURN, ret_token);
     
     if (!check(p, Tkn_Terminator) && !check(p, Tkn_CloseCurly)) {
         ret_stmt->return_stmt.value = parse_expression(p);
         if (!ret_stmt->return_stmt.value) {
-            ast_stmt_free(ret_stmt);
             return nullptr;
         }
     }
@@ -1077,16 +1365,15 @@ parse_assignment(Parser *p)
         Token operator = previous(p);
         AstExpr *value = parse_assignment(p);
         if (!value) {
-            ast_expr_free(expr);
             return nullptr;
         }
         
-        AstExpr *assign = ast_expr_create(AST_EXPR_ASSIGN, operator);
+        AstExpr *assign = new_expr(p, AST_EXPR_ASSIGN, operator);
         assign->assign.target = expr;
         assign->assign.operator = operator;
         assign->assign.value = value;
         return assign;
-    } else if (check(p, Tkn_Colon) && next(p).type == Tkn_Equal) {
+    } else if (check(p, Tkn_Colon) && peek_kind(p, 1) == Tkn_Equal) {
         // Handle := operator (two separate tokens)
         Token colon_token = current(p);
         advance(p); // consume :
@@ -1094,16 +1381,15 @@ parse_assignment(Parser *p)
         
         AstExpr *value = parse_assignment(p);
         if (!value) {
-            ast_expr_free(expr);
             return nullptr;
         }
         
-        AstExpr *assign = ast_expr_create(AST_EXPR_ASSIGN, colon_token);
+        AstExpr *assign = new_expr(p, AST_EXPR_ASSIGN, colon_token);
         assign->assign.target = expr;
         assign->assign.operator = colon_token; // Use colon token to represent :=
         assign->assign.value = value;
         return assign;
-    } else if (check(p, Tkn_Colon) && next(p).type == Tkn_Colon) {
+    } else if (check(p, Tkn_Colon) && peek_kind(p, 1) == Tkn_Colon) {
         // Handle :: operator (constant assignment)
         Token colon_token = current(p);
         advance(p); // consume first :
@@ -1111,11 +1397,10 @@ parse_assignment(Parser *p)
         
         AstExpr *value = parse_assignment(p);
         if (!value) {
-            ast_expr_free(expr);
             return nullptr;
         }
         
-        AstExpr *assign = ast_expr_create(AST_EXPR_ASSIGN, colon_token);
+        AstExpr *assign = new_expr(p, AST_EXPR_ASSIGN, colon_token);
         assign->assign.target = expr;
         assign->assign.operator = colon_token; // Use colon token to represent ::
         assign->assign.value = value;
@@ -1135,11 +1420,10 @@ parse_logical_or(Parser *p)
         Token operator = previous(p);
         AstExpr *right = parse_logical_and(p);
         if (!right) {
-            ast_expr_free(expr);
             return nullptr;
         }
         
-        AstExpr *binary = ast_expr_create(AST_EXPR_BINARY, operator);
+        AstExpr *binary = new_expr(p, AST_EXPR_BINARY, operator);
         binary->binary.left = expr;
         binary->binary.operator = operator;
         binary->binary.right = right;
@@ -1159,11 +1443,10 @@ parse_logical_and(Parser *p)
         Token operator = previous(p);
         AstExpr *right = parse_equality(p);
         if (!right) {
-            ast_expr_free(expr);
             return nullptr;
         }
         
-        AstExpr *binary = ast_expr_create(AST_EXPR_BINARY, operator);
+        AstExpr *binary = new_expr(p, AST_EXPR_BINARY, operator);
         binary->binary.left = expr;
         binary->binary.operator = operator;
         binary->binary.right = right;
@@ -1183,11 +1466,10 @@ parse_equality(Parser *p)
         Token operator = previous(p);
         AstExpr *right = parse_comparison(p);
         if (!right) {
-            ast_expr_free(expr);
             return nullptr;
         }
         
-        AstExpr *binary = ast_expr_create(AST_EXPR_BINARY, operator);
+        AstExpr *binary = new_expr(p, AST_EXPR_BINARY, operator);
         binary->binary.left = expr;
         binary->binary.operator = operator;
         binary->binary.right = right;
@@ -1208,11 +1490,10 @@ parse_comparison(Parser *p)
         Token operator = previous(p);
         AstExpr *right = parse_term(p);
         if (!right) {
-            ast_expr_free(expr);
             return nullptr;
         }
         
-        AstExpr *binary = ast_expr_create(AST_EXPR_BINARY, operator);
+        AstExpr *binary = new_expr(p, AST_EXPR_BINARY, operator);
         binary->binary.left = expr;
         binary->binary.operator = operator;
         binary->binary.right = right;
@@ -1232,11 +1513,10 @@ parse_term(Parser *p)
         Token operator = previous(p);
         AstExpr *right = parse_factor(p);
         if (!right) {
-            ast_expr_free(expr);
             return nullptr;
         }
         
-        AstExpr *binary = ast_expr_create(AST_EXPR_BINARY, operator);
+        AstExpr *binary = new_expr(p, AST_EXPR_BINARY, operator);
         binary->binary.left = expr;
         binary->binary.operator = operator;
         binary->binary.right = right;
@@ -1256,11 +1536,10 @@ parse_factor(Parser *p)
         Token operator = previous(p);
         AstExpr *right = parse_unary(p);
         if (!right) {
-            ast_expr_free(expr);
             return nullptr;
         }
         
-        AstExpr *binary = ast_expr_create(AST_EXPR_BINARY, operator);
+        AstExpr *binary = new_expr(p, AST_EXPR_BINARY, operator);
         binary->binary.left = expr;
         binary->binary.operator = operator;
         binary->binary.right = right;
@@ -1278,7 +1557,7 @@ parse_unary(Parser *p)
         AstExpr *operand = parse_unary(p);
         if (!operand) return nullptr;
         
-        AstExpr *unary = ast_expr_create(AST_EXPR_UNARY, operator);
+        AstExpr *unary = new_expr(p, AST_EXPR_UNARY, operator);
         unary->unary.operator = operator;
         unary->unary.operand = operand;
         return unary;
@@ -1296,24 +1575,22 @@ parse_call(Parser *p)
     while (true) {
         if (match(p, Tkn_OpenParen)) {
             // Function call
-            AstExpr *call = ast_expr_create(AST_EXPR_CALL, expr->token);
+            AstExpr *call = new_expr(p, AST_EXPR_CALL, expr->token);
             call->call.callee = expr;
-            call->call.arguments = array_make(AstExprPtr, 4);
+            call->call.arguments = arena_array_make(&p->arena, AstExprPtr, 4);
             
             if (!check(p, Tkn_CloseParen)) {
                 do {
                     AstExpr *arg = parse_expression(p);
                     if (!arg) {
-                        ast_expr_free(call);
                         return nullptr;
                     }
-                    array_push(call->call.arguments, arg);
+                    arena_array_push(&p->arena, call->call.arguments, arg);
                 } while (match(p, Tkn_Comma));
             }
             
             if (!match(p, Tkn_CloseParen)) {
                 log_error("Expected ')' after arguments");
-                ast_expr_free(call);
                 return nullptr;
             }
             
@@ -1322,14 +1599,13 @@ parse_call(Parser *p)
             // Member access
             if (!check(p, Tkn_Identifier)) {
                 log_error("Expected property name after '.'");
-                ast_expr_free(expr);
                 return nullptr;
             }
             
             Token member = current(p);
             advance(p);
             
-            AstExpr *member_expr = ast_expr_create(AST_EXPR_MEMBER, member);
+            AstExpr *member_expr = new_expr(p, AST_EXPR_MEMBER, member);
             member_expr->member.object = expr;
             member_expr->member.member = member;
             expr = member_expr;
@@ -1349,14 +1625,14 @@ parse_primary(Parser *p)
         match(p, Tkn_FloatLiteral) || match(p, Tkn_StringLiteral) || 
         match(p, Tkn_CharLiteral)) {
         Token literal = previous(p);
-        AstExpr *expr = ast_expr_create(AST_EXPR_LITERAL, literal);
+        AstExpr *expr = new_expr(p, AST_EXPR_LITERAL, literal);
         expr->literal.value = literal;
         return expr;
     }
     
     if (match(p, Tkn_Identifier)) {
         Token identifier = previous(p);
-        AstExpr *expr = ast_expr_create(AST_EXPR_IDENTIFIER, identifier);
+        AstExpr *expr = new_expr(p, AST_EXPR_IDENTIFIER, identifier);
         expr->identifier.name = identifier;
         return expr;
     }
@@ -1367,7 +1643,6 @@ parse_primary(Parser *p)
         
         if (!match(p, Tkn_CloseParen)) {
             log_error("Expected ')' after expression");
-            ast_expr_free(expr);
             return nullptr;
         }
         
@@ -1387,7 +1662,7 @@ parse_type(Parser *p)
     if (match(p, Tkn_IntKeyword) || match(p, Tkn_UIntKeyword) || 
         match(p, Tkn_FltKeyword) || match(p, Tkn_BoolKeyword) || 
         match(p, Tkn_CharKeyword)) {
-        AstType *type = ast_type_create(AST_TYPE_BASIC, type_token);
+        AstType *type = new_type(p, AST_TYPE_BASIC, type_token);
         
         switch (type_token.type) {
             case Tkn_IntKeyword:
@@ -1413,32 +1688,29 @@ parse_type(Parser *p)
     }
     
     if (match(p, Tkn_Identifier)) {
-        AstType *type = ast_type_create(AST_TYPE_BASIC, type_token);
+        AstType *type = new_type(p, AST_TYPE_BASIC, type_token);
         type->user_defined.name = type_token;
         return type;
     }
     
     if (match(p, Tkn_OpenSQRBrackets)) {
         // Array type: [size]element_type
-        AstType *array_type = ast_type_create(AST_TYPE_ARRAY, type_token);
+        AstType *array_type = new_type(p, AST_TYPE_ARRAY, type_token);
         
         if (!check(p, Tkn_CloseSQRBrackets)) {
             array_type->array.size = parse_expression(p);
             if (!array_type->array.size) {
-                ast_type_free(array_type);
                 return nullptr;
             }
         }
         
         if (!match(p, Tkn_CloseSQRBrackets)) {
             log_error("Expected ']' after array size");
-            ast_type_free(array_type);
             return nullptr;
         }
         
         array_type->array.element_type = parse_type(p);
         if (!array_type->array.element_type) {
-            ast_type_free(array_type);
             return nullptr;
         }
         
@@ -1503,32 +1775,23 @@ parser_err_advice(const ParseErr error)
 u8
 parser_report_error(Parser *p)
 {
-    File *file = p->lexer->file;
-    uint line = p->error_line;
-    uint col = p->error_col;
+    File *file        = p->lexer->file;
+    const FilePos pos = file_pos(file, p->error_offset);
     
-    fprintf(stderr, " > %s%s%s:%u:%u: %serror: %s%s%s\n", BOLD, WHITE, file->name, line, col, LRED,
+    fprintf(log_output(), " > %s%s%s:%u:%u: %serror: %s%s%s\n", BOLD, WHITE, file->name, pos.line, pos.col, LRED,
             LBLUE, parser_err_msg(p->error), RESET);
     
-    // Find line boundaries for context
-    uint low = 0, high = file->length;
-    for (uint i = 0; i < file->length; i++) {
-        if (file->contents[i] == '\n') {
-            if (i < p->error_line) low = i + 1;
-            if (i >= p->error_line && high == file->length) high = i;
-        }
-    }
-    
-    uint _length = high - low;
+    // the offending line for context
+    uint _length = 0;
+    cstr text    = file_line_text(file, pos.line, &_length);
     if (_length > 0) {
-        fprintf(stderr, "  %s%u%s | %.*s\n", LYELLOW, line, RESET, _length, (file->contents + low));
+        const uint num_line_digits = get_digits_from_number(pos.line);
+        fprintf(log_output(), "  %s%u%s | %.*s\n", LYELLOW, pos.line, RESET, _length, text);
         
         // Print caret pointing to error column
-        fprintf(stderr, "  %s%s |", LYELLOW, "    ");
-        for (uint i = 0; i < col - 1; i++) fprintf(stderr, " ");
-        fprintf(stderr, "%s^%s\n", LRED, RESET);
+        fprintf(log_output(), "  %*c |%*c%s^%s\n", num_line_digits, ' ', pos.col, ' ', LRED, RESET);
     }
     
-    fprintf(stderr, " > Advice: %s%s\n", RESET, parser_err_advice(p->error));
+    fprintf(log_output(), " > Advice: %s%s\n", RESET, parser_err_advice(p->error));
     return FAILURE;
 }
@@ -24,37 +24,51 @@ typedef enum
     PE_INVALID_ENUM_MEMBER,
 } ParseErr;
 
+// tokens [first, end) of a top-level declaration, without the terminators
+// around it, and the nodes parsed for it
+typedef struct
+{
+    TknIdx first, end;
+    uint nodes;
+} AstDeclSpan;
+
+generate_array_type(AstDeclSpan);
+
 typedef struct Parser
 {
     Lexer *lexer;
     uint index;
     AstProgram *ast;
     ParseErr error;
-    uint error_line;
-    uint error_col;
+    uint error_offset; // file offset of the offending token
+    uint node_count;   // AST nodes created, for the stats
+    Arena arena; // owns every AST node and child array
+    Array(AstDeclSpan) spans; // one per ast->declarations
+    uint garbage;             // nodes of replaced declarations still in the arena
+    bool complete;            // the tree covers every token, parser_reparse can patch it
 } Parser;
 
 Parser parser_init(Lexer *);
 u8 parser_parse(Parser *);
+// splits big token arrays across `jobs` threads, same result as parser_parse
+u8 parser_parse_parallel(Parser *, uint jobs);
+// parses again only the declarations `changed` tokens touch once the lexer
+// holds the tokens after them, every other one is kept (see parser.c), a full
+// parse when there is no complete tree to patch
+u8 parser_reparse(Parser *, TknEdit changed, i64 shift);
 void parser_deinit(Parser *);
+void parser_reset(Parser *); // drops the tree, keeps the newest arena block
 
 // Error handling functions
 cstr parser_err_msg(const ParseErr error);
 cstr parser_err_advice(const ParseErr error);
 u8 parser_report_error(Parser *p);
 
-// AST creation functions
-AstProgram *ast_program_create(void);
-AstDecl *ast_decl_create(AstNodeType kind, Token token);
-AstStmt *ast_stmt_create(AstNodeType kind, Token token);
-AstExpr *ast_expr_create(AstNodeType kind, Token token);
-AstType *ast_type_create(AstNodeType kind, Token token);
-
-// AST destruction functions
-void ast_program_free(AstProgram *program);
-void ast_decl_free(AstDecl *decl);
-void ast_stmt_free(AstStmt *stmt);
-void ast_expr_free(AstExpr *expr);
-void ast_type_free(AstType *type);
+// AST creation functions, nodes are zeroed and freed with their arena
+AstProgram *ast_program_create(Arena *);
+AstDecl *ast_decl_create(Arena *, AstNodeType kind, Token token);
+AstStmt *ast_stmt_create(Arena *, AstNodeType kind, Token token);
+AstExpr *ast_expr_create(Arena *, AstNodeType kind, Token token);
+AstType *ast_type_create(Arena *, AstNodeType kind, Token token);
 
 // internal methods are in parser.c
@@ -0,0 +1,198 @@
+#include "scan.h"
+
+#if defined(__x86_64__)
+#define SCAN_X86 1
+#include <immintrin.h>
+#else
+#define SCAN_X86 0
+#endif
+
+// clang-format off
+const u8 scan_class[256] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, // 0x00
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x10
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x20
+    0x1a, 0x1a, 0x1a, 0x1a, 0x1a, 0x1a, 0x1a, 0x1a, 0x1a, 0x1a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x30
+    0x00, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, // 0x40
+    0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x08, // 0x50
+    0x00, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, // 0x60
+    0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x70
+    // 0x80 - 0xff: non ascii bytes belong to no class
+};
+// clang-format on
+
+/*
+ *
+ * Scalar kernels (portable fallback)
+ *
+ */
+internal uint
+scan_whitespace_scalar(cstr str)
+{
+    uint n = 0;
+    while (scan_is(str[n], CC_SPACE)) n++;
+    return n;
+}
+
+internal uint
+scan_identifier_scalar(cstr str)
+{
+    uint n = 0;
+    while (scan_is(str[n], CC_IDENT)) n++;
+    return n;
+}
+
+internal uint
+scan_digits_scalar(cstr str)
+{
+    uint n = 0;
+    while (scan_is(str[n], CC_DIGIT)) n++;
+    return n;
+}
+
+internal uint
+scan_line_scalar(cstr str)
+{
+    uint n = 0;
+    while (str[n] != '\n' && str[n] != '\0') n++;
+    return n;
+}
+
+internal const ScanKernels scan_kernels_scalar = {
+    "scalar", scan_whitespace_scalar, scan_identifier_scalar, scan_digits_scalar, scan_line_scalar,
+};
+
+#if SCAN_X86
+/*
+ *
+ * SSE2 kernels, 16 bytes per step
+ * NOTE(5717): every ascii byte is positive as a signed char, so the signed
+ * compares below reject bytes >= 0x80 for free
+ *
+ */
+#define SSE_RANGE(v, lo, hi)                                                                       \
+    _mm_and_si128(_mm_cmpgt_epi8((v), _mm_set1_epi8((lo) - 1)),                                    \
+                  _mm_cmplt_epi8((v), _mm_set1_epi8((hi) + 1)))
+
+#define SSE_SCAN(str, classify)                                                                    \
+    do                                                                                             \
+    {                                                                                              \
+        for (uint n = 0;; n += 16)                                                                 \
+        {                                                                                          \
+            const __m128i v = _mm_loadu_si128((const __m128i *)((str) + n));                       \
+            const u32 miss  = (u32)_mm_movemask_epi8(classify) ^ 0xFFFFu;                          \
+            if (miss) return n + (uint)__builtin_ctz(miss);                                        \
+        }                                                                                          \
+    } while (0)
+
+internal uint
+scan_whitespace_sse2(cstr str)
+{
+    SSE_SCAN(str, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                               _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')))));
+}
+
+internal uint
+scan_identifier_sse2(cstr str)
+{
+    SSE_SCAN(str, _mm_or_si128(SSE_RANGE(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z'),
+                               _mm_or_si128(SSE_RANGE(v, '0', '9'),
+                                            _mm_cmpeq_epi8(v, _mm_set1_epi8('_')))));
+}
+
+internal uint
+scan_digits_sse2(cstr str)
+{
+    SSE_SCAN(str, SSE_RANGE(v, '0', '9'));
+}
+
+internal uint
+scan_line_sse2(cstr str)
+{
+    // classify the bytes that are *not* terminators
+    SSE_SCAN(str, _mm_xor_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                             _mm_cmpeq_epi8(v, _mm_setzero_si128())),
+                                _mm_set1_epi8(-1)));
+}
+
+internal const ScanKernels scan_kernels_sse2 = {
+    "sse2", scan_whitespace_sse2, scan_identifier_sse2, scan_digits_sse2, scan_line_sse2,
+};
+
+/*
+ *
+ * AVX2 kernels, 32 bytes per step
+ *
+ */
+#define AVX_RANGE(v, lo, hi)                                                                       \
+    _mm256_and_si256(_mm256_cmpgt_epi8((v), _mm256_set1_epi8((lo) - 1)),                           \
+                     _mm256_cmpgt_epi8(_mm256_set1_epi8((hi) + 1), (v)))
+
+#define AVX_SCAN(str, classify)                                                                    \
+    do                                                                                             \
+    {                                                                                              \
+        for (uint n = 0;; n += 32)                                                                 \
+        {                                                                                          \
+            const __m256i v = _mm256_loadu_si256((const __m256i *)((str) + n));                    \
+            const u32 miss  = ~(u32)_mm256_movemask_epi8(classify);                                \
+            if (miss) return n + (uint)__builtin_ctz(miss);                                        \
+        }                                                                                          \
+    } while (0)
+
+#define SCAN_AVX2 __attribute__((target("avx2")))
+
+SCAN_AVX2 internal uint
+scan_whitespace_avx2(cstr str)
+{
+    AVX_SCAN(str, _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                  _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                                                  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')))));
+}
+
+SCAN_AVX2 internal uint
+scan_identifier_avx2(cstr str)
+{
+    AVX_SCAN(str,
+             _mm256_or_si256(AVX_RANGE(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z'),
+                             _mm256_or_si256(AVX_RANGE(v, '0', '9'),
+                                             _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')))));
+}
+
+SCAN_AVX2 internal uint
+scan_digits_avx2(cstr str)
+{
+    AVX_SCAN(str, AVX_RANGE(v, '0', '9'));
+}
+
+SCAN_AVX2 internal uint
+scan_line_avx2(cstr str)
+{
+    AVX_SCAN(str, _mm256_xor_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                                   _mm256_cmpeq_epi8(v, _mm256_setzero_si256())),
+                                   _mm256_set1_epi8(-1)));
+}
+
+internal const ScanKernels scan_kernels_avx2 = {
+    "avx2", scan_whitespace_avx2, scan_identifier_avx2, scan_digits_avx2, scan_line_avx2,
+};
+#endif // SCAN_X86
+
+const ScanKernels *scan_kernels = &scan_kernels_scalar;
+
+// runs before main, so lexers on any thread see the final kernels
+// NOTE(5717): ROTATE_SCAN=scalar|sse2 forces a narrower kernel set
+__attribute__((constructor)) internal void
+scan_select_kernels(void)
+{
+#if SCAN_X86
+    cstr forced = getenv("ROTATE_SCAN");
+    if (forced && string_cmp(forced, "scalar")) return;
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && !(forced && string_cmp(forced, "sse2")))
+        scan_kernels = &scan_kernels_avx2;
+    else
+        scan_kernels = &scan_kernels_sse2;
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../include/common.h"
+
+// character classes used by the lexer, indexed by the unsigned byte value
+typedef enum
+{
+    CC_SPACE  = 1 << 0, // ' ', '\t', '\r' (newlines are tokens)
+    CC_DIGIT  = 1 << 1, // 0-9
+    CC_ALPHA  = 1 << 2, // a-z A-Z
+    CC_IDENT  = 1 << 3, // a-z A-Z 0-9 _
+    CC_XDIGIT = 1 << 4, // 0-9 a-f A-F
+} CharClass;
+
+extern const u8 scan_class[256];
+
+#define scan_is(c, cls) ((scan_class[(u8)(c)] & (cls)) != 0)
+
+// Each kernel returns the length of the run starting at `str`.
+// NOTE(5717): kernels read whole vector lanes, `str` must point into a
+// buffer that has FILE_TAIL_PADDING readable bytes after its NUL terminator
+typedef uint (*ScanFn)(cstr);
+
+typedef struct
+{
+    cstr name;
+    ScanFn whitespace; // run of CC_SPACE
+    ScanFn identifier; // run of CC_IDENT
+    ScanFn digits;     // run of CC_DIGIT
+    ScanFn line;       // bytes up to '\n' or '\0'
+} ScanKernels;
+
+// selected once at startup from the cpu features
+extern const ScanKernels *scan_kernels;
+
+// short runs are the common case, so the first byte is checked inline
+static inline uint
+scan_whitespace(cstr str)
+{
+    return scan_is(str[0], CC_SPACE) ? scan_kernels->whitespace(str) : 0;
+}
+
+static inline uint
+scan_identifier(cstr str)
+{
+    return scan_is(str[0], CC_IDENT) ? scan_kernels->identifier(str) : 0;
+}
+
+static inline uint
+scan_digits(cstr str)
+{
+    return scan_is(str[0], CC_DIGIT) ? scan_kernels->digits(str) : 0;
+}
+
+static inline uint
+scan_line(cstr str)
+{
+    return scan_kernels->line(str);
+}
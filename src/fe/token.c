@@ -102,11 +102,11 @@ lexer_err_msg(const LexErr error)
         case LE_TABS: return "Tabs '\\t' are unsupported";
         case LE_NOT_VALID_ESCAPE_CHAR: return "Invalid escaped char";
         case LE_NOT_CLOSED_COMMENT: return "Comment not closed";
-        case LE_UNSUPPORTED: break;
+        case LE_UNSUPPORTED: return "Unsupported syntax";
         case LE_UNKNOWN: break;
     }
-    TODO("error msg implementation.");
-    return "TODO: error msg implementation.";
+    // every failing lex_* sets an error, this only keeps a bad one from exiting a server
+    return "Unable to lex this";
 }
 
 cstr
@@ -127,9 +127,160 @@ lexer_err_advice(const LexErr error)
         case LE_FILE_EMPTY: return "Do not compile empty files";
         case LE_BAD_TOKEN_AT_GLOBAL: return "Do not put this token in global scope";
         case LE_TABS: return "Convert the tabs to spaces";
-        case LE_UNSUPPORTED: break;
+        case LE_UNSUPPORTED: return "Rewrite it without this syntax";
         case LE_UNKNOWN: break;
     }
-    TODO("error msg implementation.");
-    return "TODO: error msg implementation.";
+    return "Check the text at this position";
+}
+
+/*
+ *
+ * Packed token stream
+ *
+ */
+TokenStream
+tkn_stream_make(usize capacity)
+{
+    TokenStream s = {
+        .kinds   = array_make(u8, capacity),
+        .starts  = array_make(uint, capacity),
+        .lengths = array_make(u8, capacity),
+        .syms    = array_make(uint, capacity),
+        .longs   = array_make(TknLong, 16),
+    };
+    ASSERT(s.kinds && s.starts && s.lengths && s.syms && s.longs, "token stream allocation failed");
+    return s;
+}
+
+void
+tkn_stream_free(TokenStream *s)
+{
+    array_free(s->kinds);
+    array_free(s->starts);
+    array_free(s->lengths);
+    array_free(s->syms);
+    array_free(s->longs);
+    *s = (TokenStream){0};
+}
+
+void
+tkn_stream_clear(TokenStream *s)
+{
+    s->kinds->count   = 0;
+    s->starts->count  = 0;
+    s->lengths->count = 0;
+    s->syms->count    = 0;
+    s->longs->count   = 0;
+}
+
+void
+tkn_stream_push(TokenStream *s, Token tkn)
+{
+    if (tkn.length >= TKN_LONG_LENGTH)
+    {
+        const TknLong entry = {(TknIdx)tkn_count(s), tkn.length};
+        array_push(s->longs, entry);
+    }
+    array_push(s->kinds, (u8)tkn.type);
+    array_push(s->starts, tkn.index);
+    array_push(s->lengths, (u8)(tkn.length < TKN_LONG_LENGTH ? tkn.length : TKN_LONG_LENGTH));
+    array_push(s->syms, tkn.sym);
+}
+
+void
+tkn_stream_append(TokenStream *dst, const TokenStream *src, usize from)
+{
+    const usize n = tkn_count(src) - from;
+    const TknIdx base = (TknIdx)tkn_count(dst);
+
+    for_each(src->longs, entry)
+    {
+        if (entry->token < from) continue;
+        const TknLong moved = {base + (entry->token - (TknIdx)from), entry->length};
+        array_push(dst->longs, moved);
+    }
+    array_append(dst->kinds, src->kinds->elements + from, n);
+    array_append(dst->starts, src->starts->elements + from, n);
+    array_append(dst->lengths, src->lengths->elements + from, n);
+    array_append(dst->syms, src->syms->elements + from, n);
+}
+
+void
+tkn_stream_splice(TokenStream *dst, TknIdx from, TknIdx to, const TokenStream *src, usize count, i64 shift)
+{
+    const i64 moved = (i64)count - (i64)(to - from); // index change of the tail
+
+    // longs stay sorted: the head, those of src, the tail renumbered
+    Array(TknLong) longs = array_make(TknLong, array_count(dst->longs) + 4);
+    for_each(dst->longs, entry)
+    {
+        if (entry->token < from) array_push(longs, *entry);
+    }
+    for_each(src->longs, entry)
+    {
+        if (entry->token >= count) break;
+        const TknLong inserted = {from + entry->token, entry->length};
+        array_push(longs, inserted);
+    }
+    for_each(dst->longs, entry)
+    {
+        if (entry->token < to) continue;
+        const TknLong kept = {(TknIdx)((i64)entry->token + moved), entry->length};
+        array_push(longs, kept);
+    }
+    array_free(dst->longs);
+    dst->longs = longs;
+
+    array_splice(dst->kinds, from, to, src->kinds->elements, count);
+    array_splice(dst->starts, from, to, src->starts->elements, count);
+    array_splice(dst->lengths, from, to, src->lengths->elements, count);
+    array_splice(dst->syms, from, to, src->syms->elements, count);
+
+    uint *starts = dst->starts->elements;
+    for (usize t = from + count; t < tkn_count(dst); t++) starts[t] = (uint)((i64)starts[t] + shift);
+}
+
+uint
+tkn_long_length(const TokenStream *s, TknIdx i)
+{
+    usize lo = 0, hi = array_count(s->longs);
+    while (lo < hi)
+    {
+        const usize mid = lo + (hi - lo) / 2;
+        if (array_at(s->longs, mid).token < i) lo = mid + 1;
+        else hi = mid;
+    }
+    ASSERT(lo < array_count(s->longs) && array_at(s->longs, lo).token == i, "missing long token");
+    return array_at(s->longs, lo).length;
+}
+
+/*
+ *
+ * Decoded literals
+ *
+ */
+LitTable
+lit_table_make(usize capacity)
+{
+    LitTable t = {
+        .values = array_make(LitValue, capacity),
+        .bytes  = array_make(u8, capacity * 4 + 16),
+    };
+    ASSERT(t.values && t.bytes, "literal table allocation failed");
+    return t;
+}
+
+void
+lit_table_free(LitTable *t)
+{
+    array_free(t->values);
+    array_free(t->bytes);
+    *t = (LitTable){0};
+}
+
+void
+lit_table_clear(LitTable *t)
+{
+    t->values->count = 0;
+    t->bytes->count  = 0;
 }
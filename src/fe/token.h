@@ -3,6 +3,7 @@
 #include "../include/arraylist.h"
 #include "../include/common.h"
 #include "../include/file.h"
+#include "../include/intern.h"
 
 typedef uint TknIdx;
 
@@ -87,12 +88,170 @@ typedef enum
 
 cstr tkn_type_describe(const TknType type);
 
+// X(spelling, first char, last char, token type)
+// every keyword the lexer recognizes, the lexer builds its perfect hash
+// table from this list so new keywords only need a line here
+// NOTE(5717): spellings must be 2..8 chars long
+#define TKN_KEYWORDS(X)                                                                            \
+    X("as", 'a', 's', Tkn_AsKeyword)                                                               \
+    X("fn", 'f', 'n', Tkn_FnKeyword)                                                               \
+    X("if", 'i', 'f', Tkn_IfKeyword)                                                               \
+    X("in", 'i', 'n', Tkn_InKeyword)                                                               \
+    X("or", 'o', 'r', Tkn_OrKeyword)                                                               \
+    X("let", 'l', 't', Tkn_LetKeyword)                                                             \
+    X("for", 'f', 'r', Tkn_ForKeyword)                                                             \
+    X("pub", 'p', 'b', Tkn_PubKeyword)                                                             \
+    X("int", 'i', 't', Tkn_IntKeyword)                                                             \
+    X("ref", 'r', 'f', Tkn_RefKeyword)                                                             \
+    X("ret", 'r', 't', Tkn_RetKeyword)                                                             \
+    X("and", 'a', 'd', Tkn_AndKeyword)                                                             \
+    X("nil", 'n', 'l', Tkn_NilLiteral)                                                             \
+    X("new", 'n', 'w', Tkn_NewKeyword)                                                             \
+    X("else", 'e', 'e', Tkn_ElseKeyword)                                                           \
+    X("enum", 'e', 'm', Tkn_EnumKeyword)                                                           \
+    X("true", 't', 'e', Tkn_TrueLiteral)                                                           \
+    X("char", 'c', 'r', Tkn_CharKeyword)                                                           \
+    X("bool", 'b', 'l', Tkn_BoolKeyword)                                                           \
+    X("uint", 'u', 't', Tkn_UIntKeyword)                                                           \
+    X("fall", 'f', 'l', Tkn_FallKeyword)                                                           \
+    X("while", 'w', 'e', Tkn_WhileKeyword)                                                         \
+    X("false", 'f', 'e', Tkn_FalseLiteral)                                                         \
+    X("float", 'f', 't', Tkn_FltKeyword)                                                           \
+    X("break", 'b', 'k', Tkn_BreakKeyword)                                                         \
+    X("defer", 'd', 'r', Tkn_DeferKeyword)                                                         \
+    X("import", 'i', 't', Tkn_ImportKeyword)                                                       \
+    X("delete", 'd', 'e', Tkn_DeleteKeyword)                                                       \
+    X("struct", 's', 't', Tkn_StructKeyword)                                                       \
+    X("switch", 's', 'h', Tkn_SwitchKeyword)                                                       \
+    X("return", 'r', 'n', Tkn_RetKeyword)                                                          \
+    X("variant", 'v', 't', Tkn_VariantKeyword)
+
 typedef struct
 {
-    uint index, length, line;
+    uint index, length;
     TknType type;
+    Sym sym; // interned spelling of names, literal id of numbers, chars and strings, SYM_NONE otherwise
 } Token;
 
+static_assert(Tkn_EOT <= 0xFF, "token kinds are stored in one byte");
+
+// Packed token stream
+// NOTE(5717): a token is a one byte kind, a u32 start offset, a one byte
+// length and a u32 Sym, 10 bytes against 16 for a Token with its line.
+// The rare token longer than TKN_LONG_LENGTH stores the marker and keeps
+// its real length in `longs`. Lines are not stored, they come from the
+// file line index.
+#define TKN_LONG_LENGTH 0xFFu
+
+typedef struct
+{
+    TknIdx token;
+    uint length;
+} TknLong;
+
+generate_array_type(TknLong);
+
+typedef struct
+{
+    Array(u8) kinds; // TknType
+    Array(uint) starts;
+    Array(u8) lengths;
+    Array(uint) syms;     // Sym or literal id, SYM_NONE for the other tokens
+    Array(TknLong) longs; // sorted by token
+} TokenStream;
+
+TokenStream tkn_stream_make(usize capacity);
+void tkn_stream_free(TokenStream *);
+void tkn_stream_clear(TokenStream *);
+void tkn_stream_push(TokenStream *, Token);
+// appends src tokens [from..], src must not alias dst
+void tkn_stream_append(TokenStream *dst, const TokenStream *src, usize from);
+// replaces dst tokens [from, to) with the first `count` tokens of src and
+// moves the start of every token after them by `shift` bytes
+void tkn_stream_splice(TokenStream *dst, TknIdx from, TknIdx to, const TokenStream *src, usize count,
+                       i64 shift);
+
+// tokens [from, from + removed) of a stream replaced by `inserted` new ones
+typedef struct
+{
+    TknIdx from;
+    uint removed, inserted;
+} TknEdit;
+uint tkn_long_length(const TokenStream *, TknIdx);
+
+#define tkn_count(s)    array_count((s)->kinds)
+#define tkn_kind(s, i)  ((TknType)array_at((s)->kinds, (i)))
+#define tkn_start(s, i) array_at((s)->starts, (i))
+#define tkn_sym(s, i)   ((Sym)array_at((s)->syms, (i)))
+
+static inline uint
+tkn_length(const TokenStream *s, TknIdx i)
+{
+    const u8 length = array_at(s->lengths, i);
+    return length == TKN_LONG_LENGTH ? tkn_long_length(s, i) : length;
+}
+
+static inline Token
+tkn_at(const TokenStream *s, TknIdx i)
+{
+    return (Token){tkn_start(s, i), tkn_length(s, i), tkn_kind(s, i), array_at(s->syms, i)};
+}
+
+// Decoded literals
+// NOTE(5717): the lexer decodes every number, char and string literal once,
+// while its bytes are still in cache, the token keeps the id of its value
+// in the sym slot. Integers hold up to 128 bits in two halves, decimals past
+// that saturate to all ones. Chars hold their byte in `i.lo`. Strings are
+// unescaped into `bytes`, each followed by a NUL, and addressed by offset so
+// the table can be appended to another one or stored in the parse cache.
+typedef union
+{
+    struct
+    {
+        u64 lo, hi;
+    } i;
+    f64 f;
+    struct
+    {
+        uint offset, length;
+    } s;
+} LitValue;
+
+static_assert(sizeof(LitValue) == 16, "literal values are stored packed");
+
+generate_array_type(LitValue);
+
+#define LIT_NONE 0u // id 0 is never handed out
+
+typedef struct
+{
+    Array(LitValue) values; // by id - 1
+    Array(u8) bytes;
+} LitTable;
+
+LitTable lit_table_make(usize capacity);
+void lit_table_free(LitTable *);
+void lit_table_clear(LitTable *);
+
+static inline bool
+is_token_a_literal(TknType type)
+{
+    return type == Tkn_IntegerLiteral || type == Tkn_FloatLiteral || type == Tkn_CharLiteral ||
+           type == Tkn_StringLiteral;
+}
+
+static inline const LitValue *
+lit_value(const LitTable *t, uint id)
+{
+    return &array_at(t->values, id - 1);
+}
+
+static inline cstr
+lit_string(const LitTable *t, const LitValue *value)
+{
+    return (cstr)t->bytes->elements + value->s.offset;
+}
+
 typedef enum
 {
     // Unknown token/error (default)
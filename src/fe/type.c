@@ -21,3 +21,217 @@ get_base_type_string(BaseType t)
     UNREACHABLE();
     return nullptr;
 }
+
+cstr
+const_value_describe(ConstValue value, char *buffer, usize size)
+{
+    switch (value.kind)
+    {
+        case CONST_INT: snprintf(buffer, size, "%lld", (long long)value.i); break;
+        case CONST_FLOAT: snprintf(buffer, size, "%g", value.f); break;
+        case CONST_BOOL: snprintf(buffer, size, "%s", value.b ? "true" : "false"); break;
+        default: snprintf(buffer, size, "-"); break;
+    }
+    return buffer;
+}
+
+cstr
+ast_kind_describe(AstNodeType kind)
+{
+    switch (kind)
+    {
+        case AST_DECL_IMPORT: return "DECL_IMPORT";
+        case AST_DECL_FUNCTION: return "DECL_FUNCTION";
+        case AST_DECL_VARIABLE: return "DECL_VARIABLE";
+        case AST_DECL_STRUCT: return "DECL_STRUCT";
+        case AST_DECL_ENUM: return "DECL_ENUM";
+        case AST_STMT_EXPR: return "STMT_EXPR";
+        case AST_STMT_DECL: return "STMT_DECL";
+        case AST_STMT_IF: return "STMT_IF";
+        case AST_STMT_WHILE: return "STMT_WHILE";
+        case AST_STMT_FOR: return "STMT_FOR";
+        case AST_STMT_RETURN: return "STMT_RETURN";
+        case AST_STMT_BREAK: return "STMT_BREAK";
+        case AST_STMT_DEFER: return "STMT_DEFER";
+        case AST_STMT_BLOCK: return "STMT_BLOCK";
+        case AST_EXPR_LITERAL: return "EXPR_LITERAL";
+        case AST_EXPR_IDENTIFIER: return "EXPR_IDENTIFIER";
+        case AST_EXPR_BINARY: return "EXPR_BINARY";
+        case AST_EXPR_UNARY: return "EXPR_UNARY";
+        case AST_EXPR_CALL: return "EXPR_CALL";
+        case AST_EXPR_MEMBER: return "EXPR_MEMBER";
+        case AST_EXPR_ASSIGN: return "EXPR_ASSIGN";
+        case AST_TYPE_BASIC: return "TYPE_BASIC";
+        case AST_TYPE_ARRAY: return "TYPE_ARRAY";
+        case AST_TYPE_FUNCTION: return "TYPE_FUNCTION";
+        case AST_TYPE_STRUCT: return "TYPE_STRUCT";
+        case AST_TYPE_ENUM: return "TYPE_ENUM";
+    }
+    UNREACHABLE();
+    return nullptr;
+}
+
+/*
+ *
+ * Type table
+ *
+ */
+#define TYPE_MIN_SLOTS 256u
+
+internal TypeSlots *
+type_slots_make(uint count)
+{
+    TypeSlots *s = mem_alloc(sizeof(TypeSlots) + sizeof(TypeIndex) * count);
+    memset(s, 0, sizeof(TypeSlots) + sizeof(TypeIndex) * count);
+    s->mask = count - 1;
+    return s;
+}
+
+// frees the arrays `s` replaced
+internal void
+type_slots_free_before(TypeSlots *s)
+{
+    for (TypeSlots *next = s->before; next;)
+    {
+        TypeSlots *before = next->before;
+        mem_free(next);
+        next = before;
+    }
+    s->before = nullptr;
+}
+
+internal u64
+type_hash(const TypeEntry *e)
+{
+    u64 h = ((u64)e->kind << 56) ^ ((u64)e->of << 24) ^ e->count ^ ((u64)e->decl << 32);
+    for (uint i = 0; e->params && i < e->count; i++) h = (h ^ e->params[i]) * 0x100000001B3ull;
+    return (h * 0x9E3779B97F4A7C15ull) >> 32;
+}
+
+internal bool
+type_equal(const TypeEntry *a, const TypeEntry *b)
+{
+    if (a->kind != b->kind || a->of != b->of || a->count != b->count || a->decl != b->decl) return false;
+    return !a->params || !memcmp(a->params, b->params, sizeof(TypeIndex) * a->count);
+}
+
+// slot holding the type, or the empty slot where it would go
+internal uint
+type_probe(const TypeTable *t, const TypeSlots *s, const TypeEntry *e)
+{
+    uint at = (uint)type_hash(e) & s->mask;
+    for (TypeIndex index; (index = __atomic_load_n(&s->slot[at], __ATOMIC_ACQUIRE));)
+    {
+        if (type_equal(type_entry(t, index), e)) break;
+        at = (at + 1) & s->mask;
+    }
+    return at;
+}
+
+internal TypeIndex
+type_append(TypeTable *t, const TypeEntry *e)
+{
+    const TypeIndex index = t->count++;
+    const uint chunk      = index >> TYPE_CHUNK_SHIFT;
+    ASSERT(chunk < TYPE_MAX_CHUNKS, "Too many types");
+    if (!t->chunks[chunk]) t->chunks[chunk] = arena_alloc(&t->arena, sizeof(TypeEntry) << TYPE_CHUNK_SHIFT);
+    *type_entry(t, index) = *e;
+    return index;
+}
+
+// the old array stays for the threads still probing it, a miss there takes the lock
+internal void
+type_grow(TypeTable *t)
+{
+    TypeSlots *s = type_slots_make((t->slots->mask + 1) * 2);
+    s->before    = t->slots;
+    for (TypeIndex i = BT_TBD + 1; i < t->count; i++) s->slot[type_probe(t, s, type_entry(t, i))] = i;
+    __atomic_store_n(&t->slots, s, __ATOMIC_RELEASE);
+}
+
+// the index of `e`, a new one when it was never seen, its params are copied
+internal TypeIndex
+type_intern(TypeTable *t, TypeEntry e)
+{
+    // most types are made by the globals pass, a body mostly finds them without the lock
+    const TypeSlots *seen = __atomic_load_n(&t->slots, __ATOMIC_ACQUIRE);
+    TypeIndex index       = __atomic_load_n(&seen->slot[type_probe(t, seen, &e)], __ATOMIC_ACQUIRE);
+    if (index) return index;
+
+    pthread_mutex_lock(&t->lock);
+    uint at = type_probe(t, t->slots, &e);
+    if (!t->slots->slot[at]) {
+        if (e.params) {
+            TypeIndex *params = arena_alloc(&t->arena, sizeof(TypeIndex) * (e.count ? e.count : 1));
+            memcpy(params, e.params, sizeof(TypeIndex) * e.count);
+            e.params = params;
+        }
+        // the entry is written before its slot is published to the threads probing without the lock
+        __atomic_store_n(&t->slots->slot[at], type_append(t, &e), __ATOMIC_RELEASE);
+        if ((t->count - BT_TBD) * 2 > t->slots->mask + 1) type_grow(t);
+        at = type_probe(t, t->slots, &e);
+    }
+    index = t->slots->slot[at];
+    pthread_mutex_unlock(&t->lock);
+    return index;
+}
+
+void
+type_table_init(TypeTable *t)
+{
+    *t       = (TypeTable){.arena = arena_make(sizeof(TypeEntry) << TYPE_CHUNK_SHIFT)};
+    t->slots = type_slots_make(TYPE_MIN_SLOTS);
+    pthread_mutex_init(&t->lock, nullptr);
+    type_table_clear(t);
+}
+
+void
+type_table_free(TypeTable *t)
+{
+    arena_free(&t->arena);
+    // a checker that never ran has a zeroed table
+    if (t->slots) {
+        type_slots_free_before(t->slots);
+        mem_free(t->slots);
+        pthread_mutex_destroy(&t->lock);
+    }
+    *t = (TypeTable){0};
+}
+
+void
+type_table_clear(TypeTable *t)
+{
+    arena_reset(&t->arena);
+    memset(t->chunks, 0, sizeof(t->chunks));
+    type_slots_free_before(t->slots);
+    memset(t->slots->slot, 0, sizeof(TypeIndex) * (t->slots->mask + 1));
+    t->count = 0;
+    for (uint base = BT_Invalid; base <= BT_TBD; base++)
+    {
+        type_append(t, &(TypeEntry){.kind = AST_TYPE_BASIC, .base = (u8)base});
+    }
+}
+
+TypeIndex
+type_array(TypeTable *t, TypeIndex element, uint size)
+{
+    return type_intern(t, (TypeEntry){.kind = AST_TYPE_ARRAY, .of = element, .count = size});
+}
+
+TypeIndex
+type_function(TypeTable *t, const TypeIndex *params, uint count, TypeIndex ret)
+{
+    static const TypeIndex none = TYPE_NONE; // params of a function without any
+    return type_intern(t, (TypeEntry){
+                              .kind   = AST_TYPE_FUNCTION,
+                              .of     = ret,
+                              .count  = count,
+                              .params = count ? params : &none,
+                          });
+}
+
+TypeIndex
+type_named(TypeTable *t, AstNodeType kind, uint decl, Token name)
+{
+    return type_intern(t, (TypeEntry){.kind = (u8)kind, .decl = decl, .name = name});
+}
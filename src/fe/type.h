@@ -1,5 +1,7 @@
 #pragma once
 
+#include <pthread.h>
+
 #include "token.h"
 #include "../include/arraylist.h"
 
@@ -26,6 +28,25 @@ typedef enum
     BT_TBD,  // TO BE DETERMINED
 } BaseType;
 
+// Value of a constant expression
+typedef enum
+{
+    CONST_NONE, // not constant, or not evaluated yet
+    CONST_INT,  // ints and chars
+    CONST_FLOAT,
+    CONST_BOOL,
+} ConstKind;
+
+typedef struct
+{
+    u8 kind; // ConstKind
+    union {
+        i64 i;
+        f64 f;
+        bool b;
+    };
+} ConstValue;
+
 // Forward declarations for AST nodes
 typedef struct AstNode AstNode;
 typedef struct AstType AstType;
@@ -113,11 +134,13 @@ typedef struct AstExpr
 {
     AstNodeType kind;
     Token token;
-    AstType *type;
+    TypeIndex type;    // into the checker's TypeTable, TYPE_NONE until checked
+    ConstValue folded; // of a folded unary or binary expression, CONST_NONE otherwise, set along `type`
     
     union {
         struct {
             Token value;
+            ConstValue constant; // decoded by the checker, CONST_NONE for strings and nil
         } literal;
         
         struct {
@@ -257,3 +280,61 @@ typedef struct AstProgram
 {
     Array(AstDeclPtr) declarations;
 } AstProgram;
+
+cstr get_base_type_string(BaseType);
+cstr const_value_describe(ConstValue, char *buffer, usize size);
+cstr ast_kind_describe(AstNodeType);
+
+// Type table
+// NOTE(5717): every type the checker knows is interned once and named by its
+// TypeIndex, so two types are the same exactly when their indices are. The
+// basic types come first, their index is their BaseType. An array is keyed by
+// its element and size, a function by its parameters and return type, a
+// struct or enum by the declaration that made it. Entries sit in chunks that
+// never move, reading one by index needs no lock. Function bodies are checked
+// on several threads: a lookup probes the slots without the lock, only a miss
+// takes it to add the type. Growing publishes a new slot array and keeps the
+// old one for the threads still probing it until the table is cleared.
+#define TYPE_NONE        ((TypeIndex)BT_Invalid) // an expression not checked yet
+#define TYPE_NO_SIZE     RUINT_MAX                 // unsized array, or a size unknown to the checker
+#define TYPE_CHUNK_SHIFT 10u
+#define TYPE_CHUNK_MASK  ((1u << TYPE_CHUNK_SHIFT) - 1)
+#define TYPE_MAX_CHUNKS  1024u
+
+generate_array_type(TypeIndex);
+
+typedef struct
+{
+    u8 kind;                 // AST_TYPE_*
+    u8 base;                 // BaseType of a basic type
+    TypeIndex of;            // element of an array, return type of a function
+    uint count;              // size of an array, parameters of a function
+    const TypeIndex *params; // of a function
+    uint decl;               // the struct or enum declaration, as the checker numbers them
+    Token name;              // of a struct or enum
+} TypeEntry;
+
+typedef struct TypeSlots
+{
+    struct TypeSlots *before; // the smaller array it replaced
+    uint mask;
+    TypeIndex slot[]; // 0 for an empty slot, basic types are not hashed
+} TypeSlots;
+
+typedef struct
+{
+    Arena arena; // chunks and parameter lists
+    TypeEntry *chunks[TYPE_MAX_CHUNKS];
+    uint count;
+    TypeSlots *slots;     // swapped whole when it grows
+    pthread_mutex_t lock; // held to add a type
+} TypeTable;
+
+#define type_entry(t, index) (&(t)->chunks[(index) >> TYPE_CHUNK_SHIFT][(index) & TYPE_CHUNK_MASK])
+
+void type_table_init(TypeTable *);
+void type_table_free(TypeTable *);
+void type_table_clear(TypeTable *); // back to the basic types
+TypeIndex type_array(TypeTable *, TypeIndex element, uint size);
+TypeIndex type_function(TypeTable *, const TypeIndex *params, uint count, TypeIndex ret);
+TypeIndex type_named(TypeTable *, AstNodeType kind, uint decl, Token name);
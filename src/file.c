@@ -2,13 +2,50 @@
 #include "include/defines.h"
 #include <sys/stat.h>
 
+#if !OS_WIN
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// files at least this big are mapped instead of copied to the heap
+#define FILE_MMAP_THRESHOLD (1u << 20)
+
+#if !OS_WIN
+/// NOTE:
+/// maps the file read-only on top of a zeroed anonymous reservation
+/// so the bytes after EOF are always readable NUL terminators, even
+/// when the file length is an exact multiple of the page size
+internal char *
+file_map(int fd, usize length, usize *mapped_size)
+{
+    const usize page = (usize)sysconf(_SC_PAGESIZE);
+    const usize size = (length + FILE_TAIL_PADDING + page - 1) & ~(page - 1);
+
+    char *base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return nullptr;
+
+    if (mmap(base, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(base, size);
+        return nullptr;
+    }
+
+    madvise(base, length, MADV_SEQUENTIAL);
+    *mapped_size = size;
+    return base;
+}
+#endif
+
 /// NOTE:
 /// the whole file will be read at once
 /// to avoid potential problems with the
 /// filesystem during reading as developers
-/// may modify the files during reading
-File
-file_read(cstr name)
+/// may modify the files during reading;
+/// files above FILE_MMAP_THRESHOLD are mapped
+/// instead to skip the copy into the heap
+/// unless `map` is off
+internal File
+file_read_as(cstr name, bool map)
 {
     const usize len = strlen(name);
 
@@ -16,14 +53,14 @@ file_read(cstr name)
     if (len < 3)
     {
         log_error("File name is too short to have a valid extension");
-        return (File){nullptr, nullptr, 0, failure};
+        return (File){nullptr, nullptr, 0, failure, FK_NONE, 0, nullptr};
     }
 
     cstr file_ext = &(name)[len - 3];
     if (strcmp(file_ext, ".vr") != 0)
     {
         log_error("File name must end with .vr");
-        return (File){nullptr, nullptr, 0, failure};
+        return (File){nullptr, nullptr, 0, failure, FK_NONE, 0, nullptr};
     }
 
     // Open file
@@ -31,7 +68,7 @@ file_read(cstr name)
     if (!file)
     {
         log_error("File does not exist");
-        return (File){nullptr, nullptr, 0, failure};
+        return (File){nullptr, nullptr, 0, failure, FK_NONE, 0, nullptr};
     }
 
     // Get file size using fstat
@@ -40,7 +77,7 @@ file_read(cstr name)
     {
         log_error("Failed to get file size");
         fclose(file);
-        return (File){nullptr, nullptr, 0, failure};
+        return (File){nullptr, nullptr, 0, failure, FK_NONE, 0, nullptr};
     }
 
     const usize length = (usize)file_stat.st_size;
@@ -49,36 +86,50 @@ file_read(cstr name)
     {
         log_error("File is empty");
         fclose(file);
-        return (File){nullptr, nullptr, 0, failure};
+        return (File){nullptr, nullptr, 0, failure, FK_NONE, 0, nullptr};
     }
 
-    if (length > (RUINT_MAX - EXTRA_NULL_TERMINATORS))
+    if (length > (RUINT_MAX - FILE_TAIL_PADDING))
     {
         log_error("File is too large");
         fclose(file);
-        return (File){nullptr, nullptr, 0, failure};
+        return (File){nullptr, nullptr, 0, failure, FK_NONE, 0, nullptr};
     }
 
-    // Allocate buffer
-    char *buffer = malloc(length + EXTRA_NULL_TERMINATORS);
-    if (!buffer)
+    char *buffer     = nullptr;
+    FileKind kind    = FK_HEAP;
+    usize mapped_len = 0;
+
+#if !OS_WIN
+    if (map && length >= FILE_MMAP_THRESHOLD)
     {
-        fclose(file);
-        exit_error("Memory allocation failure");
+        buffer = file_map(fileno(file), length, &mapped_len);
+        if (buffer) kind = FK_MMAP;
     }
+#endif
 
-    // Read file contents
-    if (fread(buffer, sizeof(char), length, file) != length)
+    if (!buffer)
     {
-        log_error("Read file error");
-        fclose(file);
-        free(buffer);
-        return (File){nullptr, nullptr, 0, failure};
-    }
+        // Allocate buffer
+        buffer = malloc(length + FILE_TAIL_PADDING);
+        if (!buffer)
+        {
+            fclose(file);
+            exit_error("Memory allocation failure");
+        }
 
-    // Add null terminators
-    for (u8 i = 0; i < EXTRA_NULL_TERMINATORS; i++)
-        buffer[length + i] = '\0';
+        // Read file contents
+        if (fread(buffer, sizeof(char), length, file) != length)
+        {
+            log_error("Read file error");
+            fclose(file);
+            free(buffer);
+            return (File){nullptr, nullptr, 0, failure, FK_NONE, 0, nullptr};
+        }
+
+        // Add null terminators and the zeroed tail
+        memset(buffer + length, '\0', FILE_TAIL_PADDING);
+    }
 
     // Validate first character
     char c = buffer[0];
@@ -86,23 +137,89 @@ file_read(cstr name)
     {
         log_error("Only ASCII text files are supported for compilation");
         fclose(file);
-        free(buffer);
-        return (File){nullptr, nullptr, 0, failure};
+        File bad = (File){name, buffer, (uint)length, failure, kind, mapped_len, nullptr};
+        file_free(&bad);
+        return (File){nullptr, nullptr, 0, failure, FK_NONE, 0, nullptr};
     }
 
     // Close file
     fclose(file);
 
-    File res = (File){name, buffer, (uint)length, success};
+    File res = (File){name, buffer, (uint)length, success, kind, mapped_len, nullptr};
     return res;
 }
 
+File
+file_read(cstr name)
+{
+    return file_read_as(name, true);
+}
+
+File
+file_read_copy(cstr name)
+{
+    return file_read_as(name, false);
+}
+
 void
 file_free(File *file)
 {
-    if (file && file->contents)
-    {
+    if (!file || !file->contents) return;
+
+#if !OS_WIN
+    if (file->kind == FK_MMAP)
+        munmap(file->contents, file->mapped_size);
+    else
+#endif
         mem_free(file->contents);
-        file->contents = nullptr;
+
+    if (file->lines) array_free(file->lines);
+    file->lines    = nullptr;
+    file->contents = nullptr;
+    file->kind     = FK_NONE;
+}
+
+internal void
+file_index_lines(File *file)
+{
+    file->lines = array_make(uint, file->length / 32 + 16);
+    array_push(file->lines, 0u);
+
+    cstr begin = file->contents;
+    cstr end   = begin + file->length;
+    for (cstr c = begin; (c = memchr(c, '\n', (usize)(end - c))) != nullptr;)
+    {
+        c++;
+        array_push(file->lines, (uint)(c - begin));
+    }
+}
+
+FilePos
+file_pos(File *file, uint offset)
+{
+    if (!file->lines) file_index_lines(file);
+
+    // last line start <= offset
+    usize lo = 0, hi = array_count(file->lines);
+    while (hi - lo > 1)
+    {
+        const usize mid = lo + (hi - lo) / 2;
+        if (array_at(file->lines, mid) <= offset) lo = mid;
+        else hi = mid;
     }
+    return (FilePos){(uint)lo + 1, offset - array_at(file->lines, lo) + 1};
+}
+
+cstr
+file_line_text(File *file, uint line, uint *length)
+{
+    if (!file->lines) file_index_lines(file);
+    ASSERT(line >= 1 && line <= array_count(file->lines), "line out of range");
+
+    const uint start = array_at(file->lines, line - 1);
+    uint end         = line < array_count(file->lines) ? array_at(file->lines, line) - 1 : file->length;
+    if (end > start && file->contents[end - 1] == '\r') end--;
+
+    *length = end - start;
+    return file->contents + start;
 }
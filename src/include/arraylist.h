@@ -61,26 +61,66 @@ static inline Array_Header *array_new(Array_Header *header, usize initial_size)
     return header;
 }
 
+// NOTE(5717): buffers come from mem_alloc/mem_resize (mem.h) so they are counted
 #define array_make(T, size)                                                                        \
-    ((Array(T))array_new(malloc(sizeof(Array_Header) + (size) * sizeof(T)), (size)))
+    ((Array(T))array_new(mem_alloc(sizeof(Array_Header) + (size) * sizeof(T)), (size)))
 
-#define array_free(arr) free(arr)
+#define array_free(arr) mem_free(arr)
 #define array_push(arr, value)                                                                     \
     do                                                                                             \
     {                                                                                              \
         if ((arr)->count + 1 > (arr)->capacity)                                                    \
         {                                                                                          \
             (arr)->capacity <<= 1;                                                                 \
-            void *temp = realloc((arr), array_total_size(arr));                                   \
+            void *temp = mem_resize((arr), array_total_size(arr));                                \
             ASSERT(temp != nullptr, "Array realloc failed");                                            \
             (arr) = temp;                                                                          \
         }                                                                                          \
         (arr)->elements[(arr)->count++] = (value);                                                 \
     } while (0)
 
+// appends n elements copied from src, growing the array at most once
+#define array_append(arr, src, n)                                                                  \
+    do                                                                                             \
+    {                                                                                              \
+        const usize _needed = (arr)->count + (n);                                                  \
+        if (_needed > (arr)->capacity)                                                             \
+        {                                                                                          \
+            while ((arr)->capacity < _needed) (arr)->capacity = (arr)->capacity * 2 + 1;           \
+            void *temp = mem_resize((arr), array_total_size(arr));                                 \
+            ASSERT(temp != nullptr, "Array realloc failed");                                       \
+            (arr) = temp;                                                                          \
+        }                                                                                          \
+        memcpy((arr)->elements + (arr)->count, (src), (n) * sizeof(seq_elem_type(arr)));           \
+        (arr)->count = _needed;                                                                    \
+    } while (0)
+
+// replaces elements [from, to) with n elements copied from src, the tail moves
+#define array_splice(arr, from, to, src, n)                                                        \
+    do                                                                                             \
+    {                                                                                              \
+        const usize _tail   = (arr)->count - (to);                                                 \
+        const usize _needed = (from) + (n) + _tail;                                                \
+        if (_needed > (arr)->capacity)                                                             \
+        {                                                                                          \
+            while ((arr)->capacity < _needed) (arr)->capacity = (arr)->capacity * 2 + 1;           \
+            void *temp = mem_resize((arr), array_total_size(arr));                                 \
+            ASSERT(temp != nullptr, "Array realloc failed");                                       \
+            (arr) = temp;                                                                          \
+        }                                                                                          \
+        memmove((arr)->elements + (from) + (n), (arr)->elements + (to),                            \
+                _tail * sizeof(seq_elem_type(arr)));                                               \
+        memcpy((arr)->elements + (from), (src), (n) * sizeof(seq_elem_type(arr)));                 \
+        (arr)->count = _needed;                                                                    \
+    } while (0)
+
 #define array_start(arr) seq_start(arr)
 #define array_end(arr)   ((arr)->elements + ((arr)->count - 1))
 #define array_at(arr, idx) ((arr)->elements[(idx)])
 #define array_length(arr) seq_length(arr)
 #define array_count(arr) seq_length(arr)
 #define array_for_each(arr, el) for_each(arr, el)
+
+// arrays of plain scalars, shared by the packed token and AST layouts
+generate_array_type(u8);
+generate_array_type(uint);
@@ -9,16 +9,54 @@ typedef enum
     ST_FILE,
     ST_LEXER,
     ST_PARSER,
+    ST_MODULES, // import resolution and ordering
+    ST_CACHE,   // parse cache lookups and stores
     ST_TCHECKER,
     ST_LOGGER,
     // TODO: add the rest
+    ST_COUNT, // number of stages, keep last
 } Stage;
 cstr main_err(Stage);
 /*
  *  Utilites
  */
 
+// Timing
+typedef struct
+{
+    u64 wall_ns, cpu_ns;
+} TimeStamp;
+
+typedef struct
+{
+    f64 wall, cpu; // seconds
+} TimeSpan;
+
+TimeStamp time_now(void); // monotonic wall clock and process cpu clock
+TimeSpan time_since(TimeStamp);
+// cpu time of the calling thread instead of the process from now on,
+// for workers timing their own share of a parallel run
+void time_thread_cpu(bool);
+usize mem_peak_rss(void); // bytes, 0 when unknown
+
 // Loggin
+// NOTE(5717): diagnostics go to stderr unless the calling thread
+// redirects them, batch workers buffer theirs per file
+FILE *log_output(void);
+void log_set_output(FILE *); // nullptr restores stderr
+
+// diagnostics of the calling thread kept in memory until flushed, captures nest
+typedef struct
+{
+    FILE *stream;
+    FILE *outer; // output of the thread before the capture
+    char *text;  // malloc'ed by the stream
+    size_t length;
+} LogCapture;
+
+void log_capture_begin(LogCapture *);
+void log_capture_end(LogCapture *);   // back to the outer output, keeps the text
+void log_capture_flush(LogCapture *); // writes the text to the thread's output and frees it
 void log_stage(cstr);
 void log_error(cstr);
 void exit_error(cstr);
@@ -29,6 +67,8 @@ void log_error_unknown_flag(cstr str);
 
 // cstr utils
 bool string_cmp(cstr, cstr);
+// 64 bit hash of a byte range (wyhash style), for content keys not tables
+u64 hash_bytes(const void *, usize length, u64 seed);
 
 char *string_dup(cstr, const usize);
 //
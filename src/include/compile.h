@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common.h"
+#include "file.h"
+#include "../fe/checker.h"
 
 void print_version_and_exit(void);
 
@@ -8,11 +10,27 @@ typedef struct
 {
     i32 argc;
     i8 **argv;
-    cstr filename;
+    cstr filename; // first input
+    char **files;  // every input, directories and globs expanded
+    uint file_count;
+    char **input_dirs; // inputs that were directories, --watch watches their whole tree
+    uint input_dir_count;
+    char **include_dirs; // -I, module search roots, imports are loaded when set
+    uint include_count;
+    cstr cache_dir; // --cache, nullptr when parse results are not cached
     bool debug_info;
     bool debug_symbols;
     bool timer;
+    bool timer_json; // timer report as json on stdout
     bool lex_only;
+    uint jobs; // worker threads, files are spread over them in batch mode
+    uint bench_runs;   // --bench N, 0 for a single compilation
+    uint bench_warmup; // untimed runs before the bench runs
+    bool server;       // --server, serve compile requests on `socket_path`
+    bool client;       // --client, send the arguments to the server instead
+    bool shutdown;     // --client --shutdown stops the server
+    bool watch;        // --watch, compile again whenever an input changes
+    cstr socket_path;
     Stage st;
 } compile_options;
 
@@ -20,8 +38,23 @@ typedef struct
 {
     uint file_size;
     uint token_count;
+    uint node_count;
+    TimeSpan stages[ST_COUNT]; // by Stage, zero for stages that did not run
+    uint file_count;           // inputs compiled, more than one in batch mode
+    uint module_count;         // modules loaded through imports, the input included
+    uint failed_count;         // inputs that failed
+    uint cache_hits;           // files whose tokens and tree came from the cache or server memory
     u8 status;
 } compile_info_stats;
 
+cstr stage_to_string(Stage);
+// one input, or a batch over `jobs` threads with the stats of every file summed
 compile_info_stats compile(compile_options *options);
+compile_info_stats compile_bench(compile_options *options); // prints its own report
+// one input read into caller owned buffers, those of a previous compilation are reused
+compile_info_stats compile_warm(compile_options *options, File *, Lexer *, Parser *, Checker *);
+void compile_stats_add(compile_info_stats *total, const compile_info_stats *);
+// outcome on stderr and the --timer/--json report on stdout, returns the exit code
+int compile_report(compile_options *options, compile_info_stats, TimeSpan total);
 compile_options compile_options_new(const i32 argc, i8 **argv);
+void compile_options_free(compile_options *);
@@ -202,7 +202,11 @@ typedef u32 uint;
 #define RUINT_MIN 0u
 
 #define EXTRA_NULL_TERMINATORS 3u
+// zeroed bytes kept after file contents, lets the lexer load whole
+// vector lanes near EOF without bounds checks
+#define FILE_TAIL_PADDING 64u
 
 static_assert(EXTRA_NULL_TERMINATORS > 2u, "keep the number above 2");
+static_assert(FILE_TAIL_PADDING >= EXTRA_NULL_TERMINATORS + 32u, "padding must fit a vector lane");
 static_assert(RUINT_MIN == 0u, "Min number should unsigned 0");
 static_assert(RUINT_MAX == UINT32_MAX, "Max number");
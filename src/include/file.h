@@ -1,5 +1,6 @@
 #pragma once
 
+#include "arraylist.h"
 #include "common.h"
 
 typedef enum
@@ -8,13 +9,34 @@ typedef enum
     success,
 } valid;
 
+typedef enum
+{
+    FK_NONE = 0,
+    FK_HEAP, // contents allocated with mem_alloc
+    FK_MMAP, // contents mapped read-only from disk
+} FileKind;
+
 typedef struct
 {
     cstr name;
     char *contents;
     const uint length; // contents length
     valid valid_code;
+    FileKind kind;
+    usize mapped_size; // size of the mapping (FK_MMAP only)
+    Array(uint) lines; // start offset of every line, built on first use
 } File;
 
+typedef struct
+{
+    uint line, col; // both 1 based
+} FilePos;
+
 File file_read(cstr name);
+// never mapped, for contents kept while the file may change on disk
+File file_read_copy(cstr name);
 void file_free(File *);
+// NOTE(5717): the line index is built once with memchr on first use,
+// lookups are a binary search over the line starts
+FilePos file_pos(File *, uint offset);
+cstr file_line_text(File *, uint line, uint *length); // without the newline
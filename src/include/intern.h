@@ -0,0 +1,41 @@
+#pragma once
+
+#include "mem.h"
+
+// String interner
+// NOTE(5717): every distinct spelling gets a small integer id, names are
+// compared by id after lexing. Keys are copied into the interner arena
+// (NUL terminated) so they outlive the source file, the table is open
+// addressing with linear probing over u32 slots holding the id.
+typedef uint Sym;
+
+#define SYM_NONE 0u // id 0 is never handed out
+
+typedef struct
+{
+    cstr str;
+    uint length;
+    u32 hash;
+} InternKey;
+
+generate_array_type(InternKey);
+
+typedef struct
+{
+    Arena arena;
+    Array(InternKey) keys; // keys[sym - 1]
+    u32 *slots;            // 0 or a sym, power of two sized
+    uint mask;
+} Interner;
+
+Interner intern_make(usize capacity);
+void intern_free(Interner *);
+void intern_clear(Interner *); // forgets every key, keeps the buffers
+Sym intern(Interner *, cstr str, uint length);
+// sym of an existing key, SYM_NONE when the string was never interned
+Sym intern_find(const Interner *, cstr str, uint length);
+u32 intern_hash(cstr str, uint length);
+
+#define intern_count(in)      array_count((in)->keys)
+#define intern_key(in, sym)   (&array_at((in)->keys, (sym) - 1))
+#define intern_str(in, sym)   (intern_key((in), (sym))->str)
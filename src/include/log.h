@@ -1,7 +1,7 @@
 #pragma once
 
+#include "../fe/checker.h"
 #include "../fe/lexer.h"
-#include "../fe/parser.h"
 #include "common.h"
 
-void log_compilation(FILE *, File *, Lexer *, Parser *);
+void log_compilation(FILE *, File *, Lexer *, Parser *, Checker *);
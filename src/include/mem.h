@@ -1,6 +1,40 @@
 #pragma once
 
+#include "arraylist.h"
+
 // Memory allocation
 void *mem_alloc(usize size);
 void *mem_resize(void *blk, usize size);
 void mem_free(void *blk);
+usize mem_allocation_count(void); // mem_alloc and mem_resize calls so far, all threads
+
+// Arena (bump) allocator
+// NOTE(5717): blocks are chained and never moved, everything allocated
+// from an arena lives until arena_reset/arena_free, there is no single free
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct
+{
+    ArenaBlock *head; // block being filled, older blocks hang off it
+    usize block_size; // minimum size of a new block
+} Arena;
+
+Arena arena_make(usize block_size);
+void *arena_alloc(Arena *, usize size); // zeroed and 16 byte aligned
+void arena_reset(Arena *);              // keeps the newest block for reuse
+void arena_free(Arena *);
+void arena_adopt(Arena *, Arena *from); // takes every block of `from`, which ends up empty
+
+// Arrays whose buffers live in an arena, growing abandons the old buffer
+void *arena_array_grow(Arena *, void *arr, usize elem_size);
+
+#define arena_array_make(arena, T, size)                                                           \
+    ((Array(T))array_new(arena_alloc((arena), sizeof(Array_Header) + (size) * sizeof(T)), (size)))
+
+#define arena_array_push(arena, arr, value)                                                        \
+    do                                                                                             \
+    {                                                                                              \
+        if ((arr)->count + 1 > (arr)->capacity)                                                    \
+            (arr) = arena_array_grow((arena), (arr), sizeof(seq_elem_type(arr)));                  \
+        (arr)->elements[(arr)->count++] = (value);                                                 \
+    } while (0)
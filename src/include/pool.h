@@ -0,0 +1,14 @@
+#pragma once
+
+#include "common.h"
+
+// task(ctx, index) is called once for every index in [0, count)
+typedef void (*PoolTask)(void *ctx, uint index);
+
+// Runs the tasks on up to `jobs` threads, the calling thread included.
+// Workers pull the next index from a shared counter, so uneven tasks
+// balance themselves. Returns once every task has finished.
+void pool_run(uint jobs, uint count, PoolTask task, void *ctx);
+
+// number of online cpus, at least 1
+uint pool_cpu_count(void);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "compile.h"
+
+// Compile server
+// NOTE(5717): `rotate --server` listens on a unix domain socket and serves one
+// request at a time, `rotate --client ARGS...` sends its working directory and
+// ARGS and the server compiles from there as `rotate ARGS` would. The answer is
+// the exit code and whatever the compilation wrote to stdout and stderr. Every
+// file compiled stays in memory (see warm.h) and unchanged ones are not
+// compiled again. Module mode (-I) and --bench run cold.
+//
+// wire format, every integer a u32 in host order (the socket is local):
+//   request:  length, then `length` bytes of NUL terminated strings: cwd, args...
+//   response: exit code, stdout length, stderr length, then both texts
+#define SERVER_DEFAULT_SOCKET ".rotate.sock"
+
+// serves until a --shutdown request or SIGINT/SIGTERM, returns the exit code
+int server_run(compile_options *options);
+// forwards the arguments and prints the answer, returns the exit code of the
+// compilation or -1 when no server listens on options->socket_path
+int client_run(compile_options *options);
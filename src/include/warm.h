@@ -0,0 +1,51 @@
+#pragma once
+
+#include "compile.h"
+#include "intern.h"
+
+// Warm files
+// NOTE(5717): the File, tokens and tree of every file compiled by a long
+// running process (server, watch mode), kept by canonical path. A file whose
+// inode, size and mtime did not change since its last compilation is not read
+// again, its stats and diagnostics are replayed, a changed one is lexed,
+// parsed and checked into its old buffers (compile_warm). After a successful
+// parse its imports are resolved to other warm files, so the importers of a
+// changed file can be found.
+typedef struct
+{
+    File file; // name is the canonical path, owned by the set
+    Lexer lexer;
+    Parser parser;
+    Checker checker;
+    bool compiled;
+    bool lex_only;            // what the last compilation ran
+    u64 dev, ino, size;       // identity of the file it read
+    u64 mtime_ns;
+    compile_info_stats stats; // of the last compilation
+    Stage st;
+    LogCapture diag;          // its diagnostics, replayed while the file is unchanged
+    Array(uint) imports;      // warm index of every resolved import
+} WarmFile;
+
+typedef WarmFile *WarmFilePtr;
+generate_array_type(WarmFilePtr);
+
+typedef struct
+{
+    Interner paths; // canonical paths, sym - 1 indexes files
+    Array(WarmFilePtr) files;
+} WarmSet;
+
+WarmSet warm_set_make(void);
+void warm_set_free(WarmSet *);
+// warm index of a canonical path, the entry is created uncompiled on first sight
+uint warm_index(WarmSet *, cstr path);
+// compiles `input` unless it is unchanged (or `force`), its diagnostics go to
+// stderr and options->st is the stage it stopped at
+compile_info_stats warm_compile(WarmSet *, compile_options *options, cstr input, bool force);
+// warm indices of the files importing `index`, directly or not, ascending
+Array(uint) warm_importers(const WarmSet *, uint index);
+
+#define warm_count(set)    array_count((set)->files)
+#define warm_at(set, idx)  array_at((set)->files, (idx))
+#define warm_path(set, idx) intern_str(&(set)->paths, (idx) + 1)
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "compile.h"
+
+// Watch mode
+// NOTE(5717): `rotate --watch DIR|FILE...` compiles every input once, then
+// waits on inotify for the directories holding file inputs and for the whole
+// tree below a directory input (and any directory created inside those later). A .vr file written or moved in is compiled again with
+// every file that imports it, directly or not (see warm.h), everything else
+// stays in memory untouched. Events closer than WATCH_SETTLE_MS to each other
+// make one round, editors save a file in several steps.
+#define WATCH_SETTLE_MS 15
+
+// runs until SIGINT/SIGTERM, returns the exit code
+int watch_run(compile_options *options);
@@ -3,6 +3,8 @@
 #include "include/compile.h"
 #include "include/file.h"
 
+#include "fe/checker.h"
+#include "fe/flat.h"
 #include "fe/lexer.h"
 #include "fe/parser.h"
 #include "fe/token.h"
@@ -43,14 +45,13 @@ log_tokens(FILE *output, File *code_file, Lexer *lexer)
     fprintf(output, "** TOKENS" ORGMODE_NEWLINE);
     fprintf(output, "#+begin_src" ORGMODE_NEWLINE);
     
-    uint i = 0;
-    Token tkn;
-    array_for_each(lexer->tokens, tkn)
+    const TokenStream *tokens = &lexer->tokens;
+    for (TknIdx i = 0; i < tkn_count(tokens); i++)
     {
+        const Token tkn = tkn_at(tokens, i);
         fprintf(output, "[TOKEN]: n: %u, idx: %u, line: %u, len: %u, type: %s, val: `%.*s`" ORGMODE_NEWLINE,
-                i, tkn->index, tkn->line, tkn->length, tkn_type_describe(tkn->type), tkn->length,
-                code_file->contents + tkn->index);
-        i++;
+                i, tkn.index, file_pos(code_file, tkn.index).line, tkn.length, tkn_type_describe(tkn.type),
+                tkn.length, code_file->contents + tkn.index);
     }
     fprintf(output, "#+end_src" ORGMODE_NEWLINE);
 }
@@ -112,18 +113,65 @@ log_ast(FILE *output, File *code_file, Parser *parser)
         fprintf(output, "No AST declarations found" ORGMODE_NEWLINE);
     }
     fprintf(output, "#+end_src" ORGMODE_NEWLINE);
-    fprintf(output, ORGMODE_NEWLINE "** TODO TYPECHECKER" ORGMODE_NEWLINE);
+}
+
+internal void
+log_flat_ast(FILE *output, File *code_file, Lexer *lexer, Parser *parser)
+{
+    if (!parser->ast) return;
+
+    FlatAst flat = flat_ast_build(parser->ast, lexer);
+    fprintf(output, "*** Flat layout" ORGMODE_NEWLINE);
+    fprintf(output, "- nodes: %llu, extra: %llu, bytes: %llu" ORGMODE_NEWLINE,
+            flat_count(&flat), array_count(flat.extra), flat_ast_size(&flat));
+    fprintf(output, "#+begin_src" ORGMODE_NEWLINE);
+    for (usize n = 0; n < flat_count(&flat); n++)
+    {
+        const TknIdx t = flat_token(&flat, n);
+        const Token tkn = t == FLAT_NONE ? (Token){0} : tkn_at(&lexer->tokens, t);
+        fprintf(output, "[NODE]: n: %llu, kind: %s, tkn: %d, lhs: %d, rhs: %d, val: `%.*s`" ORGMODE_NEWLINE,
+                n, ast_kind_describe(flat_kind(&flat, n)), (int)t, (int)flat_lhs(&flat, n),
+                (int)flat_rhs(&flat, n), (int)tkn.length, code_file->contents + tkn.index);
+    }
+    fprintf(output, "#+end_src" ORGMODE_NEWLINE);
+    flat_ast_free(&flat);
+}
+
+internal void
+log_types(FILE *output, Parser *parser, Checker *checker)
+{
+    fprintf(output, ORGMODE_NEWLINE "** TYPECHECKER" ORGMODE_NEWLINE);
+    fprintf(output, "#+begin_src" ORGMODE_NEWLINE);
+
+    // bindings start with one global per declaration, see checker.c
+    const usize count = parser->ast && parser->ast->declarations ? array_count(parser->ast->declarations) : 0;
+    if (checker->parser != parser || count == 0 || array_count(checker->bindings) < count) {
+        fprintf(output, "No checked declarations found" ORGMODE_NEWLINE "#+end_src" ORGMODE_NEWLINE);
+        return;
+    }
+    for (usize i = 0; i < count; i++)
+    {
+        const Binding *b = &array_at(checker->bindings, i);
+        if (!b->name) continue;
+        char type[128], value[48];
+        const InternKey *name = intern_key(&parser->lexer->interner, b->name);
+        fprintf(output, "[GLOBAL]: n: %llu, name: `%.*s`, type: `%s`", i, (int)name->length, name->str,
+                checker_type_describe(checker, b->type, type, sizeof(type)));
+        if (b->value.kind) fprintf(output, ", value: %s", const_value_describe(b->value, value, sizeof(value)));
+        fprintf(output, ORGMODE_NEWLINE);
+    }
+    fprintf(output, "#+end_src" ORGMODE_NEWLINE);
 }
 
 void
-log_compilation(FILE *output, File *code_file, Lexer *lexer, Parser *parser)
+log_compilation(FILE *output, File *code_file, Lexer *lexer, Parser *parser, Checker *checker)
 {
     time_t rawtime;
     time(&rawtime);
-    assert(code_file && lexer && parser);
+    assert(code_file && lexer && parser && checker);
 
-    const Array(Token) tokens = lexer->tokens;
-    if (array_length(tokens) > MAX_LOG_TOKENS)
+    const usize token_count = tkn_count(&lexer->tokens);
+    if (token_count > MAX_LOG_TOKENS)
     {
         log_warn("File too large to show complete log");
         return;
@@ -132,10 +180,12 @@ log_compilation(FILE *output, File *code_file, Lexer *lexer, Parser *parser)
     log_warn("Logging will slow down compilation");
     
     log_header(output, rawtime);
-    log_metadata(output, code_file, rawtime, tokens->count);
+    log_metadata(output, code_file, rawtime, token_count);
     log_source_file(output, code_file);
     log_tokens(output, code_file, lexer);
     log_ast(output, code_file, parser);
+    log_flat_ast(output, code_file, lexer, parser);
+    log_types(output, parser, checker);
     
     log_info("Logging complete");
 }
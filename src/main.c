@@ -1,28 +1,7 @@
 #include "include/common.h"
 #include "include/compile.h"
-
-internal cstr
-stage_to_string(Stage s)
-{
-    switch (s)
-    {
-        case ST_FILE: return "FILE READ";
-        case ST_LEXER: return "LEXER";
-        case ST_PARSER: return "PARSER";
-        case ST_TCHECKER: return "TYPE CHECKER";
-        case ST_LOGGER: return "LOGGER";
-        default: return "UNKNOWN";
-    }
-}
-
-internal void
-print_compilation_stats(compile_info_stats stats, f128 total_time)
-{
-    printf("[%sINFO%s] : %d Tokens\n", LMAGENTA BOLD, RESET, stats.token_count);
-    printf("[%sRATE%s] : %.3Lf mb/sec\n", LMAGENTA BOLD, RESET,
-           (stats.file_size/(1024*1024))/total_time);
-    printf("[%sTIME%s] : %.5Lf sec\n", LMAGENTA BOLD, RESET, total_time);
-}
+#include "include/server.h"
+#include "include/watch.h"
 
 int
 main(const int argc, char **const argv)
@@ -36,26 +15,31 @@ main(const int argc, char **const argv)
     // parse program arguments
     compile_options comp_opt = compile_options_new(argc, argv);
 
-    // setup timer
-    clock_t start_time = clock();
-    
-    // compile
-    compile_info_stats exit_stats = compile(&comp_opt);
-
-    // handle compilation results
-    if (exit_stats.status == FAILURE) {
-        log_stage(stage_to_string(comp_opt.st));
-        fprintf(stderr, "Compilation failed at stage: %s\n", stage_to_string(comp_opt.st));
-        return FAILURE;
-    } else if (exit_stats.status == SUCCESS) {
-        log_info("Compilation succeeded.");
+    if (comp_opt.watch && !comp_opt.client) {
+        const int code = watch_run(&comp_opt);
+        compile_options_free(&comp_opt);
+        return code;
     }
 
-    // print compilation statistics
-    if (comp_opt.timer) {
-        clock_t end_time = clock();
-        f128 total_time = (f64)(end_time - start_time) / CLOCKS_PER_SEC;
-        print_compilation_stats(exit_stats, total_time);
+    // hand the request to a compile server, or become one
+    if (comp_opt.server || comp_opt.client) {
+        const int code = comp_opt.server ? server_run(&comp_opt) : client_run(&comp_opt);
+        if (code >= 0) {
+            compile_options_free(&comp_opt);
+            return code;
+        }
+        // no server is listening, the client compiles in process
     }
-    return SUCCESS;
+
+    // setup timer
+    const TimeStamp start = time_now();
+
+    // compile
+    compile_info_stats exit_stats =
+        comp_opt.bench_runs ? compile_bench(&comp_opt) : compile(&comp_opt);
+
+    // handle compilation results and print compilation statistics
+    const int code = compile_report(&comp_opt, exit_stats, time_since(start));
+    compile_options_free(&comp_opt);
+    return code;
 }
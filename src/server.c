@@ -0,0 +1,445 @@
+#include "include/server.h"
+#include "include/warm.h"
+
+#if OS_WIN
+// NOTE(5717): no unix sockets on windows yet, clients compile in process
+int
+server_run(compile_options *options)
+{
+    UNUSED(options);
+    log_error("--server needs unix domain sockets");
+    return FAILURE;
+}
+
+int
+client_run(compile_options *options)
+{
+    UNUSED(options);
+    return -1;
+}
+#else
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVER_REQUEST_MAX  (1u << 20) // bytes of arguments
+#define SERVER_TIMEOUT_SEC  5          // a silent client does not block the others for long
+#define SERVER_BACKLOG      16
+
+/*
+ *
+ * Socket io
+ *
+ */
+internal bool
+io_write_all(int fd, const void *data, usize length)
+{
+    const u8 *at = data;
+    while (length)
+    {
+        const ssize_t n = write(fd, at, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        at += n;
+        length -= (usize)n;
+    }
+    return true;
+}
+
+internal bool
+io_read_all(int fd, void *data, usize length)
+{
+    u8 *at = data;
+    while (length)
+    {
+        const ssize_t n = read(fd, at, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        at += n;
+        length -= (usize)n;
+    }
+    return true;
+}
+
+// `path` in a unix socket address, false when it does not fit
+internal bool
+socket_address(cstr path, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return false;
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+internal int
+socket_connect(cstr path)
+{
+    struct sockaddr_un addr;
+    if (!socket_address(path, &addr)) return -1;
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+typedef struct
+{
+    WarmSet warm;
+    bool stop;
+} Server;
+
+internal volatile sig_atomic_t server_signaled;
+
+internal void
+server_on_signal(int sig)
+{
+    UNUSED(sig);
+    server_signaled = 1;
+}
+
+internal compile_info_stats
+server_compile(Server *s, compile_options *options)
+{
+    if (options->server || options->client) {
+        options->st = ST_UNKNOWN;
+        log_error("--server and --client cannot be sent to a server");
+        return (compile_info_stats){.status = FAILURE};
+    }
+    if (options->bench_runs) return compile_bench(options);
+    if (options->file_count == 0 || (options->include_count && !options->lex_only)) return compile(options);
+
+    // same order, messages and stats as a batch, one file after the other
+    compile_info_stats total = {0};
+    total.file_count         = options->file_count;
+    total.status             = SUCCESS;
+    Stage first_failure      = ST_UNKNOWN;
+    for (uint i = 0; i < options->file_count; i++)
+    {
+        const compile_info_stats stats = warm_compile(&s->warm, options, options->files[i], false);
+        if (stats.status == FAILURE) {
+            if (options->file_count > 1) {
+                fprintf(stderr, "%s: compilation failed at stage: %s\n", options->files[i],
+                        stage_to_string(options->st));
+            }
+            if (total.failed_count == 0) first_failure = options->st;
+        }
+        compile_stats_add(&total, &stats);
+    }
+    if (total.failed_count) options->st = first_failure;
+    return total;
+}
+
+/*
+ *
+ * Requests
+ *
+ */
+
+// everything written to `fd` goes to an unlinked temporary file until taken back
+typedef struct
+{
+    int fd;
+    int saved;
+    FILE *temp;
+} Redirect;
+
+internal bool
+redirect_begin(Redirect *r, int fd)
+{
+    r->fd    = fd;
+    r->temp  = tmpfile();
+    r->saved = r->temp ? dup(fd) : -1;
+    if (r->saved < 0 || dup2(fileno(r->temp), fd) < 0) {
+        if (r->saved >= 0) close(r->saved);
+        if (r->temp) fclose(r->temp);
+        return false;
+    }
+    return true;
+}
+
+// restores `fd`, returns the text written meanwhile (malloc'ed)
+internal char *
+redirect_end(Redirect *r, u32 *length)
+{
+    dup2(r->saved, r->fd);
+    close(r->saved);
+
+    const int fd    = fileno(r->temp);
+    const off_t end = lseek(fd, 0, SEEK_END);
+    char *text      = nullptr;
+    *length         = 0;
+    if (end > 0 && end <= (off_t)RUINT_MAX && lseek(fd, 0, SEEK_SET) == 0) {
+        text = malloc((usize)end);
+        if (text && io_read_all(fd, text, (usize)end)) *length = (u32)end;
+    }
+    fclose(r->temp);
+    return text;
+}
+
+// a request with its strings split out, argv[0] stands for the program name
+typedef struct
+{
+    char *payload;
+    cstr cwd;
+    i8 **argv;
+    i32 argc;
+} Request;
+
+internal char server_program_name[] = "rotate";
+
+internal bool
+request_read(int fd, Request *req)
+{
+    u32 length = 0;
+    *req       = (Request){0};
+    if (!io_read_all(fd, &length, sizeof(length)) || length == 0 || length > SERVER_REQUEST_MAX) return false;
+
+    req->payload = mem_alloc(length);
+    if (!io_read_all(fd, req->payload, length) || req->payload[length - 1] != '\0') return false;
+
+    uint strings = 0;
+    for (u32 i = 0; i < length; i++) strings += req->payload[i] == '\0';
+
+    // cwd then the arguments, behind the program name
+    req->argv    = mem_alloc(sizeof(i8 *) * (strings + 1));
+    req->argv[0] = server_program_name;
+    req->argc    = 1;
+    req->cwd     = req->payload;
+    for (char *str = req->payload + strlen(req->payload) + 1; str < req->payload + length; str += strlen(str) + 1)
+    {
+        req->argv[req->argc++] = str;
+    }
+    return true;
+}
+
+internal void
+request_free(Request *req)
+{
+    mem_free(req->payload);
+    mem_free(req->argv);
+    *req = (Request){0};
+}
+
+internal bool
+request_asks_version(const Request *req)
+{
+    for (i32 i = 1; i < req->argc; i++)
+    {
+        if (!strcmp(req->argv[i], "--version") || !strcmp(req->argv[i], "-v")) return true;
+    }
+    return false;
+}
+
+// compiles as `rotate ARGS` would in the client directory, with the output of it captured
+internal void
+server_handle(Server *s, int fd, cstr home)
+{
+    Request req;
+    if (!request_read(fd, &req)) {
+        request_free(&req);
+        return;
+    }
+
+    Redirect out, err;
+    fflush(stdout);
+    if (!redirect_begin(&out, STDOUT_FILENO)) {
+        request_free(&req);
+        return;
+    }
+    if (!redirect_begin(&err, STDERR_FILENO)) {
+        u32 ignored;
+        free(redirect_end(&out, &ignored));
+        request_free(&req);
+        return;
+    }
+
+    int code = FAILURE;
+    if (chdir(req.cwd) != 0) {
+        log_error("The server cannot enter the client directory");
+    } else if (request_asks_version(&req)) {
+        log_error("--version is answered by the client");
+    } else {
+        compile_options options = compile_options_new(req.argc, req.argv);
+        if (options.shutdown) {
+            log_info("Compile server stopped");
+            s->stop = true;
+            code    = SUCCESS;
+        } else {
+            const TimeStamp start          = time_now();
+            const compile_info_stats stats = server_compile(s, &options);
+            code                           = compile_report(&options, stats, time_since(start));
+        }
+        compile_options_free(&options);
+    }
+    if (chdir(home) != 0) s->stop = true; // relative paths of later requests would go wrong
+
+    fflush(stdout);
+    fflush(stderr);
+    u32 header[3] = {(u32)code, 0, 0};
+    char *out_text = redirect_end(&out, &header[1]);
+    char *err_text = redirect_end(&err, &header[2]);
+
+    // a client that went away only loses its answer
+    if (io_write_all(fd, header, sizeof(header)) && io_write_all(fd, out_text, header[1])) {
+        io_write_all(fd, err_text, header[2]);
+    }
+    free(out_text);
+    free(err_text);
+    request_free(&req);
+}
+
+/*
+ *
+ * Entry points
+ *
+ */
+int
+server_run(compile_options *options)
+{
+    char home[PATH_MAX], path[PATH_MAX];
+    if (!getcwd(home, sizeof(home))) {
+        log_error("Unable to get the working directory");
+        return FAILURE;
+    }
+    // absolute, requests change the working directory
+    cstr socket_path = options->socket_path;
+    if (socket_path[0] != '/') {
+        const int n = snprintf(path, sizeof(path), "%s/%s", home, socket_path);
+        if (n < 0 || (usize)n >= sizeof(path)) {
+            log_error("Socket path is too long");
+            return FAILURE;
+        }
+        socket_path = path;
+    }
+
+    struct sockaddr_un addr;
+    if (!socket_address(socket_path, &addr)) {
+        log_error("Socket path is too long");
+        return FAILURE;
+    }
+    const int probe = socket_connect(socket_path);
+    if (probe >= 0) {
+        close(probe);
+        log_error("A compile server already listens on this socket");
+        return FAILURE;
+    }
+    unlink(socket_path); // left over by a server that did not stop cleanly
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SERVER_BACKLOG) != 0) {
+        log_error("Unable to listen on the socket");
+        if (fd >= 0) close(fd);
+        return FAILURE;
+    }
+
+    // no SA_RESTART, a signal has to interrupt accept
+    struct sigaction sa = {0};
+    sa.sa_handler       = server_on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    char message[PATH_MAX + 32];
+    snprintf(message, sizeof(message), "Compile server listening on %s", socket_path);
+    log_info(message);
+
+    Server s = {warm_set_make(), false};
+    while (!s.stop && !server_signaled)
+    {
+        const int client = accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            log_error("Unable to accept a client");
+            break;
+        }
+        const struct timeval timeout = {SERVER_TIMEOUT_SEC, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        server_handle(&s, client, home);
+        close(client);
+    }
+
+    close(fd);
+    unlink(socket_path);
+    warm_set_free(&s.warm);
+    return SUCCESS;
+}
+
+int
+client_run(compile_options *options)
+{
+    const int fd = socket_connect(options->socket_path);
+    if (fd < 0) {
+        struct stat st;
+        if (!options->shutdown && stat(options->socket_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+            // a server that died leaves its socket, the user should know the warm state is gone
+            log_warn("The compile server socket does not answer, compiling in process");
+        }
+        if (!options->shutdown) return -1;
+        log_error("No compile server listens on the socket");
+        return FAILURE;
+    }
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        close(fd);
+        return -1;
+    }
+
+    // the working directory, then every argument but the client ones
+    usize length = strlen(cwd) + 1;
+    for (i32 i = 1; i < options->argc; i++) length += strlen(options->argv[i]) + 1;
+    char *payload = mem_alloc(length);
+    usize at      = strlen(cwd) + 1;
+    memcpy(payload, cwd, at);
+    for (i32 i = 1; i < options->argc; i++)
+    {
+        cstr arg = options->argv[i];
+        if (!strcmp(arg, "--client")) continue;
+        if (!strcmp(arg, "--socket")) {
+            i++;
+            continue;
+        }
+        const usize n = strlen(arg) + 1;
+        memcpy(payload + at, arg, n);
+        at += n;
+    }
+
+    u32 header[3] = {FAILURE, 0, 0};
+    const u32 size = (u32)at;
+    bool ok = at <= SERVER_REQUEST_MAX && io_write_all(fd, &size, sizeof(size)) && io_write_all(fd, payload, at);
+    ok      = ok && io_read_all(fd, header, sizeof(header));
+    mem_free(payload);
+
+    // stdout first, both are passed through as they were written
+    for (uint i = 1; ok && i < 3; i++)
+    {
+        FILE *stream = i == 1 ? stdout : stderr;
+        char buffer[1 << 14];
+        for (u32 left = header[i]; ok && left;)
+        {
+            const u32 n = left < sizeof(buffer) ? left : (u32)sizeof(buffer);
+            ok          = io_read_all(fd, buffer, n);
+            if (ok) fwrite(buffer, 1, n, stream);
+            left -= ok ? n : 0;
+        }
+    }
+    close(fd);
+
+    if (!ok) {
+        log_error("The compile server did not answer");
+        return FAILURE;
+    }
+    return (int)header[0];
+}
+#endif
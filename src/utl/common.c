@@ -3,17 +3,68 @@
 #include <time.h>
 #include <math.h>
 
+#if !OS_WIN
+#include <sys/resource.h>
+#endif
+
 #define TIME_BUFFER_SIZE 20
 
+internal _Thread_local FILE *log_stream; // nullptr for stderr
+
+FILE *
+log_output(void)
+{
+    return log_stream ? log_stream : stderr;
+}
+
+void
+log_set_output(FILE *stream)
+{
+    log_stream = stream;
+}
+
+void
+log_capture_begin(LogCapture *capture)
+{
+    *capture       = (LogCapture){0};
+    capture->outer = log_stream;
+#if !OS_WIN
+    capture->stream = open_memstream(&capture->text, &capture->length);
+#endif
+    // the outer output when the stream failed
+    log_set_output(capture->stream ? capture->stream : capture->outer);
+}
+
+void
+log_capture_end(LogCapture *capture)
+{
+    log_set_output(capture->outer);
+    if (capture->stream) fclose(capture->stream);
+    capture->stream = nullptr;
+}
+
+void
+log_capture_flush(LogCapture *capture)
+{
+    if (capture->length) fwrite(capture->text, 1, capture->length, log_output());
+    free(capture->text);
+    *capture = (LogCapture){0};
+}
+
 internal void 
 log_message(const char *level, const char *color, cstr message)
 {
     time_t now = time(NULL);
-    struct tm *t = localtime(&now);
+    struct tm t;
+#if OS_WIN
+    localtime_s(&t, &now);
+#else
+    localtime_r(&now, &t);
+#endif
     char time_buffer[TIME_BUFFER_SIZE];
-    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", t);
+    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", &t);
 
-    fprintf(stderr, "[%s%s%s] [%s]: %s\n", color, level, RESET, time_buffer, message);
+    fprintf(log_output(), "[%s%s%s] [%s]: %s\n", color, level, RESET, time_buffer, message);
 }
 
 void log_stage(cstr str)
@@ -51,10 +102,64 @@ void log_info(cstr str)
     log_message("INFO", LGREEN BOLD, str);
 }
 
+// Timing
+
+internal u64
+time_clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+internal _Thread_local clockid_t time_cpu_clock = CLOCK_PROCESS_CPUTIME_ID;
+
+void
+time_thread_cpu(bool enable)
+{
+    time_cpu_clock = enable ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID;
+}
+
+TimeStamp
+time_now(void)
+{
+    return (TimeStamp){time_clock_ns(CLOCK_MONOTONIC), time_clock_ns(time_cpu_clock)};
+}
+
+TimeSpan
+time_since(TimeStamp start)
+{
+    const TimeStamp now = time_now();
+    return (TimeSpan){(f64)(now.wall_ns - start.wall_ns) / 1e9, (f64)(now.cpu_ns - start.cpu_ns) / 1e9};
+}
+
+usize
+mem_peak_rss(void)
+{
+#if !OS_WIN
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return (usize)usage.ru_maxrss; // bytes on darwin
+#else
+    return (usize)usage.ru_maxrss * 1024; // KiB elsewhere
+#endif
+#endif
+    return 0;
+}
+
 // Memory allocation
 
+internal usize mem_allocations; // only touched with atomics
+
+usize mem_allocation_count(void)
+{
+    return __atomic_load_n(&mem_allocations, __ATOMIC_RELAXED);
+}
+
 void *mem_alloc(usize size)
 {
+    __atomic_fetch_add(&mem_allocations, 1, __ATOMIC_RELAXED);
     void *result = malloc(size);
     if (!result)
     {
@@ -66,6 +171,7 @@ void *mem_alloc(usize size)
 
 void *mem_resize(void *blk, usize size)
 {
+    __atomic_fetch_add(&mem_allocations, 1, __ATOMIC_RELAXED);
     void *result = realloc(blk, size);
     if (!result)
     {
@@ -83,6 +189,99 @@ void mem_free(void *blk)
     }
 }
 
+// Arena allocator
+
+#define ARENA_ALIGN 16u
+
+struct ArenaBlock
+{
+    ArenaBlock *next; // older block
+    usize size, used;
+    _Alignas(ARENA_ALIGN) u8 data[];
+};
+
+Arena
+arena_make(usize block_size)
+{
+    return (Arena){nullptr, block_size};
+}
+
+void *
+arena_alloc(Arena *arena, usize size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(usize)(ARENA_ALIGN - 1);
+
+    ArenaBlock *block = arena->head;
+    if (!block || block->used + size > block->size)
+    {
+        const usize block_size = size > arena->block_size ? size : arena->block_size;
+        block                  = mem_alloc(sizeof(ArenaBlock) + block_size);
+        block->next            = arena->head;
+        block->size            = block_size;
+        block->used            = 0;
+        arena->head            = block;
+    }
+
+    void *result = block->data + block->used;
+    block->used += size;
+    memset(result, 0, size);
+    return result;
+}
+
+void
+arena_reset(Arena *arena)
+{
+    if (!arena->head) return;
+
+    ArenaBlock *block = arena->head->next;
+    while (block)
+    {
+        ArenaBlock *next = block->next;
+        mem_free(block);
+        block = next;
+    }
+    arena->head->next = nullptr;
+    arena->head->used = 0;
+}
+
+void
+arena_adopt(Arena *arena, Arena *from)
+{
+    if (!from->head) return;
+    if (!arena->head) {
+        arena->head = from->head;
+        from->head  = nullptr;
+        return;
+    }
+
+    // behind the block being filled, the next arena_reset frees them
+    ArenaBlock *oldest = from->head;
+    while (oldest->next) oldest = oldest->next;
+    oldest->next       = arena->head->next;
+    arena->head->next  = from->head;
+    from->head         = nullptr;
+}
+
+void
+arena_free(Arena *arena)
+{
+    arena_reset(arena);
+    mem_free(arena->head);
+    arena->head = nullptr;
+}
+
+void *
+arena_array_grow(Arena *arena, void *arr, usize elem_size)
+{
+    Array_Header *old      = arr;
+    const usize capacity   = old->capacity ? old->capacity * 2 : 4;
+    Array_Header *result   = arena_alloc(arena, sizeof(Array_Header) + capacity * elem_size);
+    result->count          = old->count;
+    result->capacity       = capacity;
+    memcpy(result + 1, old + 1, old->count * elem_size);
+    return result;
+}
+
 // NOTE: func definition in ./frontend/include/lexer.hpp
 void
 log_token(FILE *output, const Token tkn, cstr str)
@@ -94,7 +293,7 @@ log_token(FILE *output, const Token tkn, cstr str)
 void
 log_error_unknown_flag(cstr str)
 {
-    fprintf(stderr, "[%sWARN%s] : Ignored flag: `%s`\n", LYELLOW, RESET, str);
+    fprintf(log_output(), "[%sWARN%s] : Ignored flag: `%s`\n", LYELLOW, RESET, str);
 }
 
 char *
@@ -117,6 +316,53 @@ string_cmp(cstr restrict a, cstr restrict b)
     return res;
 }
 
+#define HASH_P0 0xA0761D6478BD642Full
+#define HASH_P1 0xE7037ED1A0B428DBull
+#define HASH_P2 0x8EBC6AF09C88C6E3ull
+#define HASH_P3 0x589965CC75374CC3ull
+
+internal inline u64
+hash_mum(u64 a, u64 b)
+{
+    const __uint128_t r = (__uint128_t)a * b;
+    return (u64)r ^ (u64)(r >> 64);
+}
+
+internal inline u64
+hash_read64(const u8 *p)
+{
+    u64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// NOTE(5717): three independent lanes over 48 byte blocks keep the
+// multipliers busy, the tail is folded in 16 byte steps
+u64
+hash_bytes(const void *data, usize length, u64 seed)
+{
+    const u8 *p   = data;
+    const u64 len = length;
+    u64 s0 = seed ^ HASH_P0, s1 = seed ^ HASH_P1, s2 = seed ^ HASH_P2;
+
+    for (; length >= 48; p += 48, length -= 48)
+    {
+        s0 = hash_mum(hash_read64(p) ^ HASH_P1, hash_read64(p + 8) ^ s0);
+        s1 = hash_mum(hash_read64(p + 16) ^ HASH_P2, hash_read64(p + 24) ^ s1);
+        s2 = hash_mum(hash_read64(p + 32) ^ HASH_P3, hash_read64(p + 40) ^ s2);
+    }
+    s0 ^= s1 ^ s2;
+    for (; length >= 16; p += 16, length -= 16)
+    {
+        s0 = hash_mum(hash_read64(p) ^ HASH_P1, hash_read64(p + 8) ^ s0);
+    }
+
+    u8 tail[16] = {0};
+    memcpy(tail, p, length);
+    const u64 a = hash_read64(tail), b = hash_read64(tail + 8);
+    return hash_mum(HASH_P1 ^ len, hash_mum(a ^ HASH_P1, b ^ s0));
+}
+
 uint
 get_digits_from_number(const uint num)
 {
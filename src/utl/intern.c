@@ -0,0 +1,134 @@
+#include "../include/intern.h"
+
+// key bytes are carved out of blocks of this size
+#define INTERN_ARENA_BLOCK_SIZE (64u << 10)
+#define INTERN_MIN_SLOTS 64u
+
+internal inline u64
+intern_mix(u64 h, u64 word)
+{
+    h = (h ^ word) * 0xBF58476D1CE4E5B9ull;
+    return h ^ (h >> 31);
+}
+
+u32
+intern_hash(cstr str, uint length)
+{
+    u64 h  = 0x9E3779B97F4A7C15ull ^ length;
+    uint i = 0;
+    for (; i + sizeof(u64) <= length; i += sizeof(u64))
+    {
+        u64 word;
+        memcpy(&word, str + i, sizeof(word));
+        h = intern_mix(h, word);
+    }
+    if (i < length)
+    {
+        u64 word = 0;
+        memcpy(&word, str + i, length - i);
+        h = intern_mix(h, word);
+    }
+    h ^= h >> 29;
+    h *= 0x94D049BB133111EBull;
+    return (u32)(h ^ (h >> 32));
+}
+
+internal u32 *
+intern_slots_make(uint count)
+{
+    u32 *slots = mem_alloc(sizeof(u32) * count);
+    memset(slots, 0, sizeof(u32) * count);
+    return slots;
+}
+
+Interner
+intern_make(usize capacity)
+{
+    uint slots = INTERN_MIN_SLOTS;
+    while (slots < capacity * 2) slots <<= 1;
+
+    Interner in = {
+        .arena = arena_make(INTERN_ARENA_BLOCK_SIZE),
+        .keys  = array_make(InternKey, slots / 2),
+        .slots = intern_slots_make(slots),
+        .mask  = slots - 1,
+    };
+    return in;
+}
+
+void
+intern_free(Interner *in)
+{
+    arena_free(&in->arena);
+    array_free(in->keys);
+    mem_free(in->slots);
+    *in = (Interner){0};
+}
+
+void
+intern_clear(Interner *in)
+{
+    arena_reset(&in->arena);
+    in->keys->count = 0;
+    memset(in->slots, 0, sizeof(u32) * (in->mask + 1));
+}
+
+internal void
+intern_grow(Interner *in)
+{
+    const uint count = (in->mask + 1) * 2;
+    u32 *slots       = intern_slots_make(count);
+    for (Sym sym = 1; sym <= intern_count(in); sym++)
+    {
+        uint at = intern_key(in, sym)->hash & (count - 1);
+        while (slots[at]) at = (at + 1) & (count - 1);
+        slots[at] = sym;
+    }
+    mem_free(in->slots);
+    in->slots = slots;
+    in->mask  = count - 1;
+}
+
+// slot holding the key, or the empty slot where it would go
+internal inline uint
+intern_probe(const Interner *in, cstr str, uint length, u32 hash)
+{
+    uint at = hash & in->mask;
+    for (;;)
+    {
+        const Sym sym = in->slots[at];
+        if (sym == SYM_NONE) return at;
+
+        const InternKey *key = intern_key(in, sym);
+        if (key->hash == hash && key->length == length && !memcmp(key->str, str, length)) return at;
+        at = (at + 1) & in->mask;
+    }
+}
+
+Sym
+intern(Interner *in, cstr str, uint length)
+{
+    const u32 hash = intern_hash(str, length);
+    uint at        = intern_probe(in, str, length, hash);
+    if (in->slots[at]) return in->slots[at];
+
+    if ((intern_count(in) + 1) * 2 > in->mask + 1)
+    {
+        intern_grow(in);
+        at = intern_probe(in, str, length, hash);
+    }
+
+    char *copy = arena_alloc(&in->arena, length + 1); // zeroed, so NUL terminated
+    memcpy(copy, str, length);
+    const InternKey key = {copy, length, hash};
+    array_push(in->keys, key);
+
+    in->slots[at] = (Sym)intern_count(in);
+    return in->slots[at];
+}
+
+Sym
+intern_find(const Interner *in, cstr str, uint length)
+{
+    return in->slots[intern_probe(in, str, length, intern_hash(str, length))];
+}
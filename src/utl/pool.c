@@ -0,0 +1,65 @@
+#include "../include/pool.h"
+
+#include <pthread.h>
+#if !OS_WIN
+#include <unistd.h>
+#endif
+
+typedef struct
+{
+    PoolTask task;
+    void *ctx;
+    uint count;
+    uint next; // shared, only touched with atomics
+} PoolWork;
+
+internal void *
+pool_worker(void *arg)
+{
+    PoolWork *work = arg;
+    for (;;)
+    {
+        const uint index = __atomic_fetch_add(&work->next, 1u, __ATOMIC_RELAXED);
+        if (index >= work->count) break;
+        work->task(work->ctx, index);
+    }
+    return nullptr;
+}
+
+void
+pool_run(uint jobs, uint count, PoolTask task, void *ctx)
+{
+    PoolWork work = {task, ctx, count, 0};
+    if (jobs > count) jobs = count;
+    if (jobs <= 1)
+    {
+        pool_worker(&work);
+        return;
+    }
+
+    pthread_t *threads = mem_alloc(sizeof(pthread_t) * (jobs - 1));
+    uint spawned       = 0;
+    for (; spawned < jobs - 1; spawned++)
+    {
+        // a failed spawn only costs parallelism, the others drain the work
+        if (pthread_create(&threads[spawned], nullptr, pool_worker, &work) != 0) break;
+    }
+
+    pool_worker(&work);
+    for (uint i = 0; i < spawned; i++)
+        pthread_join(threads[i], nullptr);
+
+    mem_free(threads);
+}
+
+uint
+pool_cpu_count(void)
+{
+#if OS_WIN
+    cstr env = getenv("NUMBER_OF_PROCESSORS");
+    const long n = env ? strtol(env, nullptr, 10) : 1;
+#else
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return n > 0 ? (uint)n : 1u;
+}
@@ -0,0 +1,204 @@
+#include "include/warm.h"
+
+#include "fe/module.h"
+
+#include <sys/stat.h>
+
+#define WARM_GUESS 64u
+
+#if OS_MAC
+#define STAT_MTIME_NS(st) ((u64)(st).st_mtimespec.tv_sec * 1000000000u + (u64)(st).st_mtimespec.tv_nsec)
+#elif OS_WIN
+#define STAT_MTIME_NS(st) ((u64)(st).st_mtime * 1000000000u)
+#else
+#define STAT_MTIME_NS(st) ((u64)(st).st_mtim.tv_sec * 1000000000u + (u64)(st).st_mtim.tv_nsec)
+#endif
+
+WarmSet
+warm_set_make(void)
+{
+    return (WarmSet){
+        .paths = intern_make(WARM_GUESS),
+        .files = array_make(WarmFilePtr, WARM_GUESS),
+    };
+}
+
+void
+warm_set_free(WarmSet *set)
+{
+    for (usize i = 0; i < warm_count(set); i++)
+    {
+        WarmFile *w = warm_at(set, i);
+        if (w->checker.parser) checker_deinit(&w->checker);
+        if (w->parser.lexer) parser_deinit(&w->parser);
+        if (w->lexer.file) lexer_deinit(&w->lexer);
+        file_free(&w->file);
+        free(w->diag.text);
+        array_free(w->imports);
+        mem_free(w);
+    }
+    array_free(set->files);
+    intern_free(&set->paths);
+    *set = (WarmSet){0};
+}
+
+uint
+warm_index(WarmSet *set, cstr path)
+{
+    const Sym sym = intern(&set->paths, path, (uint)strlen(path));
+    if (sym <= warm_count(set)) return sym - 1;
+
+    WarmFile *w = mem_alloc(sizeof(WarmFile));
+    memset(w, 0, sizeof(WarmFile));
+    w->imports = array_make(uint, 4);
+    array_push(set->files, w);
+    return sym - 1;
+}
+
+// canonical path and identity of an existing regular file
+internal bool
+warm_stat(cstr input, char path[PATH_MAX], struct stat *st)
+{
+#if OS_WIN
+    return _fullpath(path, input, PATH_MAX) && stat(path, st) == 0 && !(st->st_mode & S_IFDIR);
+#else
+    return realpath(input, path) && stat(path, st) == 0 && !S_ISDIR(st->st_mode);
+#endif
+}
+
+internal bool
+warm_unchanged(const WarmFile *w, const struct stat *st, const compile_options *options)
+{
+    return w->compiled && !options->debug_info && w->lex_only == options->lex_only && w->dev == (u64)st->st_dev &&
+           w->ino == (u64)st->st_ino && w->size == (u64)st->st_size && w->mtime_ns == STAT_MTIME_NS(*st);
+}
+
+// imports that resolve to a file, the others are for module mode to report
+internal void
+warm_resolve_imports(WarmSet *set, uint index, const compile_options *options)
+{
+    WarmFile *w = warm_at(set, index);
+    array_count(w->imports) = 0;
+    if (w->stats.status == FAILURE || options->lex_only || !w->parser.ast) return;
+
+    const Array(AstDeclPtr) decls = w->parser.ast->declarations;
+    for (usize i = 0; decls && i < array_count(decls); i++)
+    {
+        const AstDecl *decl = array_at(decls, i);
+        if (decl->kind != AST_DECL_IMPORT) continue;
+
+        // the path token keeps its quotes
+        const Token tkn = decl->import.module_path;
+        if (tkn.length < 3) continue;
+        char canonical[PATH_MAX];
+        if (module_lookup(w->file.name, w->file.contents + tkn.index + 1, tkn.length - 2, options->include_dirs,
+                          options->include_count, canonical)) {
+            const uint dep = warm_index(set, canonical); // files never move, only the array of them
+            array_push(w->imports, dep);
+        }
+    }
+}
+
+compile_info_stats
+warm_compile(WarmSet *set, compile_options *options, cstr input, bool force)
+{
+    compile_options one = *options;
+    one.filename        = input;
+    one.files           = nullptr;
+    one.file_count      = 1;
+    one.include_count   = 0;
+
+    char path[PATH_MAX];
+    struct stat st;
+    if (!warm_stat(input, path, &st)) {
+        const compile_info_stats stats = compile(&one); // reports the missing file
+        options->st                    = one.st;
+        return stats;
+    }
+
+    const uint index = warm_index(set, path);
+    WarmFile *w      = warm_at(set, index);
+    if (!force && warm_unchanged(w, &st, options)) {
+        compile_info_stats stats = w->stats;
+        memset(stats.stages, 0, sizeof(stats.stages));
+        stats.cache_hits = 1;
+        if (w->diag.length) fwrite(w->diag.text, 1, w->diag.length, stderr);
+        options->st = w->st;
+        return stats;
+    }
+
+    free(w->diag.text);
+    log_capture_begin(&w->diag);
+    one.filename = warm_path(set, index);
+    w->stats     = compile_warm(&one, &w->file, &w->lexer, &w->parser, &w->checker);
+    w->st        = one.st;
+    log_capture_end(&w->diag);
+
+    w->compiled = true;
+    w->lex_only = options->lex_only;
+    w->dev      = (u64)st.st_dev;
+    w->ino      = (u64)st.st_ino;
+    w->size     = (u64)st.st_size;
+    w->mtime_ns = STAT_MTIME_NS(st);
+    warm_resolve_imports(set, index, options);
+
+    if (w->diag.length) fwrite(w->diag.text, 1, w->diag.length, stderr);
+    options->st = w->st;
+    return w->stats;
+}
+
+Array(uint)
+warm_importers(const WarmSet *set, uint index)
+{
+    // users of every file as a flat adjacency list, users_start[i]..users_start[i + 1]
+    const usize count = warm_count(set);
+    uint *users_start = mem_alloc(sizeof(uint) * (count + 1));
+    memset(users_start, 0, sizeof(uint) * (count + 1));
+    usize edges = 0;
+    for (usize i = 0; i < count; i++)
+    {
+        const WarmFile *w = warm_at(set, i);
+        for (usize k = 0; k < array_count(w->imports); k++) users_start[array_at(w->imports, k) + 1]++;
+        edges += array_count(w->imports);
+    }
+    for (usize i = 0; i < count; i++) users_start[i + 1] += users_start[i];
+
+    uint *users = mem_alloc(sizeof(uint) * (edges + 1));
+    uint *fill  = mem_alloc(sizeof(uint) * (count + 1));
+    memcpy(fill, users_start, sizeof(uint) * (count + 1));
+    for (usize i = 0; i < count; i++)
+    {
+        const WarmFile *w = warm_at(set, i);
+        for (usize k = 0; k < array_count(w->imports); k++) users[fill[array_at(w->imports, k)]++] = (uint)i;
+    }
+
+    // breadth first over the users, `seen` keeps cycles from looping
+    bool *seen = mem_alloc(sizeof(bool) * count);
+    memset(seen, 0, sizeof(bool) * count);
+    Array(uint) found = array_make(uint, 8);
+    seen[index]       = true;
+    array_push(found, index);
+    for (usize at = 0; at < array_count(found); at++)
+    {
+        const uint file = array_at(found, at);
+        for (uint u = users_start[file]; u < users_start[file + 1]; u++)
+        {
+            if (seen[users[u]]) continue;
+            seen[users[u]] = true;
+            array_push(found, users[u]);
+        }
+    }
+
+    // without `index` itself, in file order
+    array_count(found) = 0;
+    for (usize i = 0; i < count; i++)
+    {
+        if (seen[i] && i != index) array_push(found, (uint)i);
+    }
+
+    mem_free(seen);
+    mem_free(fill);
+    mem_free(users);
+    mem_free(users_start);
+    return found;
+}
@@ -0,0 +1,261 @@
+#include "include/watch.h"
+#include "include/warm.h"
+
+#if !OS_LIN
+// NOTE(5717): only inotify for now, kqueue and ReadDirectoryChangesW would go here
+int
+watch_run(compile_options *options)
+{
+    UNUSED(options);
+    log_error("--watch needs inotify (linux)");
+    return FAILURE;
+}
+#else
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+#define WATCH_EXT  ".vr"
+
+typedef struct
+{
+    int fd;
+    char **dirs; // watched directory by watch descriptor, nullptr for unused ones
+    uint dir_count;
+    WarmSet warm;
+    Array(uint) changed; // warm indices of the files changed this round
+} Watcher;
+
+internal volatile sig_atomic_t watch_signaled;
+
+internal void
+watch_on_signal(int sig)
+{
+    UNUSED(sig);
+    watch_signaled = 1;
+}
+
+internal bool
+watch_is_source(cstr name)
+{
+    const usize length = strlen(name);
+    return length > strlen(WATCH_EXT) && !strcmp(name + length - strlen(WATCH_EXT), WATCH_EXT);
+}
+
+internal void
+watch_changed(Watcher *w, cstr path)
+{
+    char canonical[PATH_MAX];
+    if (!realpath(path, canonical)) return;
+    const uint index = warm_index(&w->warm, canonical);
+    for (usize i = 0; i < array_count(w->changed); i++)
+    {
+        if (array_at(w->changed, i) == index) return;
+    }
+    array_push(w->changed, index);
+}
+
+// `path` lies inside one of `dirs`
+internal bool
+watch_is_below(char **dirs, uint count, cstr path)
+{
+    for (uint i = 0; i < count; i++)
+    {
+        const usize length = strlen(dirs[i]);
+        if (!strncmp(path, dirs[i], length) && (path[length] == '/' || dirs[i][length - 1] == '/')) return true;
+    }
+    return false;
+}
+
+// watches `dir`, with `recurse` its subdirectories too and every source in them changed
+internal void
+watch_add_dir(Watcher *w, cstr dir, bool recurse)
+{
+    const int wd = inotify_add_watch(w->fd, dir, WATCH_MASK);
+    if (wd < 0) {
+        log_warn("Unable to watch a directory");
+        return;
+    }
+    if ((uint)wd >= w->dir_count) {
+        const uint count = (uint)wd * 2 + 8;
+        w->dirs          = mem_resize(w->dirs, sizeof(char *) * count);
+        memset(w->dirs + w->dir_count, 0, sizeof(char *) * (count - w->dir_count));
+        w->dir_count = count;
+    }
+    mem_free(w->dirs[wd]); // the same directory again, or a new one on a reused descriptor
+    w->dirs[wd] = string_dup(dir, strlen(dir));
+    if (!recurse) return;
+
+    DIR *d = opendir(dir);
+    if (!d) return;
+    char path[PATH_MAX];
+    struct dirent *entry;
+    while ((entry = readdir(d)))
+    {
+        if (entry->d_name[0] == '.') continue; // hidden files, `.` and `..`
+        if (snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name) >= (int)sizeof(path)) continue;
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) watch_add_dir(w, path, true);
+        else if (watch_is_source(entry->d_name)) watch_changed(w, path);
+    }
+    closedir(d);
+}
+
+internal void
+watch_free(Watcher *w)
+{
+    for (uint i = 0; i < w->dir_count; i++) mem_free(w->dirs[i]);
+    mem_free(w->dirs);
+    array_free(w->changed);
+    warm_set_free(&w->warm);
+    close(w->fd);
+}
+
+internal void
+watch_read_events(Watcher *w)
+{
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;)
+    {
+        const ssize_t length = read(w->fd, buffer, sizeof(buffer));
+        if (length <= 0) return; // EAGAIN, the queue is drained
+
+        for (char *at = buffer; at < buffer + length;)
+        {
+            const struct inotify_event *event = (const struct inotify_event *)at;
+            at += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) log_warn("Missed file events, save the file again");
+            if (!event->len || (uint)event->wd >= w->dir_count || !w->dirs[event->wd]) continue;
+            char path[PATH_MAX];
+            if (snprintf(path, sizeof(path), "%s/%s", w->dirs[event->wd], event->name) >= (int)sizeof(path)) {
+                continue;
+            }
+
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) watch_add_dir(w, path, true);
+            } else if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) && watch_is_source(event->name)) {
+                watch_changed(w, path);
+            }
+        }
+    }
+}
+
+// the changed files, then whatever imports them
+internal void
+watch_round(Watcher *w, compile_options *options)
+{
+    const TimeStamp start = time_now();
+    const usize changed   = array_count(w->changed);
+    uint compiled = 0, failed = 0;
+
+    bool *queued = mem_alloc(sizeof(bool) * warm_count(&w->warm));
+    memset(queued, 0, sizeof(bool) * warm_count(&w->warm));
+    for (usize i = 0; i < changed; i++) queued[array_at(w->changed, i)] = true;
+
+    for (usize i = 0; i < changed; i++)
+    {
+        const uint index               = array_at(w->changed, i);
+        const compile_info_stats stats = warm_compile(&w->warm, options, warm_path(&w->warm, index), false);
+        failed += stats.status == FAILURE;
+        compiled++;
+    }
+    // imports resolved by this round may have added files, they are never importers
+    for (usize i = 0; i < changed; i++)
+    {
+        Array(uint) importers = warm_importers(&w->warm, array_at(w->changed, i));
+        for (usize k = 0; k < array_count(importers); k++)
+        {
+            const uint index = array_at(importers, k);
+            if (queued[index]) continue;
+            queued[index]                  = true;
+            const compile_info_stats stats = warm_compile(&w->warm, options, warm_path(&w->warm, index), true);
+            failed += stats.status == FAILURE;
+            compiled++;
+        }
+        array_free(importers);
+    }
+    mem_free(queued);
+
+    const TimeSpan spent = time_since(start);
+    printf("[%sWATCH%s] : %u files compiled in %.3f ms (%u changed), %u failed\n", LMAGENTA BOLD, RESET, compiled,
+           spent.wall * 1e3, (uint)changed, failed);
+    fflush(stdout);
+    array_count(w->changed) = 0;
+}
+
+int
+watch_run(compile_options *options)
+{
+    if (options->file_count == 0) {
+        log_error("No input files");
+        return FAILURE;
+    }
+
+    Watcher w = {0};
+    w.fd      = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w.fd < 0) {
+        log_error("Unable to start inotify");
+        return FAILURE;
+    }
+    w.warm    = warm_set_make();
+    w.changed = array_make(uint, 16);
+
+    // directory inputs are watched with everything below them, sources created later included
+    char **dirs    = mem_alloc(sizeof(char *) * (options->input_dir_count + 1));
+    uint dir_count = 0;
+    for (uint i = 0; i < options->input_dir_count; i++)
+    {
+        char path[PATH_MAX];
+        if (!realpath(options->input_dirs[i], path)) continue;
+        watch_add_dir(&w, path, true);
+        dirs[dir_count++] = string_dup(path, strlen(path));
+    }
+
+    // every other input and the directory holding it, a missing input is reported once
+    for (uint i = 0; i < options->file_count; i++)
+    {
+        char path[PATH_MAX];
+        if (!realpath(options->files[i], path)) {
+            warm_compile(&w.warm, options, options->files[i], false);
+            continue;
+        }
+        if (watch_is_below(dirs, dir_count, path)) continue;
+        watch_changed(&w, path);
+        char *slash = strrchr(path, '/');
+        if (slash == path) slash[1] = '\0';
+        else if (slash) *slash = '\0';
+        watch_add_dir(&w, path, false);
+    }
+    for (uint i = 0; i < dir_count; i++) mem_free(dirs[i]);
+    mem_free(dirs);
+
+    struct sigaction sa = {0};
+    sa.sa_handler       = watch_on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    log_info("Watching for changes, Ctrl-C stops");
+    watch_round(&w, options);
+
+    struct pollfd pfd = {.fd = w.fd, .events = POLLIN};
+    while (!watch_signaled)
+    {
+        if (poll(&pfd, 1, -1) <= 0) continue; // EINTR on a signal
+        watch_read_events(&w);
+        while (!watch_signaled && poll(&pfd, 1, WATCH_SETTLE_MS) > 0) watch_read_events(&w);
+        if (array_count(w.changed)) watch_round(&w, options);
+    }
+
+    watch_free(&w);
+    return SUCCESS;
+}
+#endif